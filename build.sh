@@ -9,6 +9,7 @@ usage() {
 Usage:
   ./build.sh --ndk <android_ndk_dir> [--cmake <cmake_bin>] [--build-type Release|Debug]
              [--gadget-fetch true|false] [--gadget-repo <owner/repo>] [--gadget-version <ver>] [--gadget-prefix <name>]
+             [--gadget-compress true|false]
 
 What it does (no Gradle / no Java):
   - Builds native outputs via CMake + NDK toolchain for 4 ABIs:
@@ -17,6 +18,7 @@ What it does (no Gradle / no Java):
   - Stages a Magisk module directory from template/magisk_module + compiled outputs
   - Generates module.prop (replaces fields from module.conf)
   - Optionally fetches gadget .so (4 ABIs) into build/gadgets/ and packages them into module root
+  - Compresses the packaged gadgets to .so.xz (default; the companion decompresses them once per boot)
   - Produces a release zip under out/
 
 Requirements:
@@ -49,6 +51,7 @@ parse_args() {
   GADGET_REPO="hackcatml/ajeossida"
   GADGET_VERSION="16.5.2"
   GADGET_PREFIX="ajeossida-gadget"
+  GADGET_COMPRESS="true"
   while [[ $# -gt 0 ]]; do
     case "$1" in
       -h|--help)
@@ -90,6 +93,11 @@ parse_args() {
         GADGET_PREFIX="$2"
         shift 2
         ;;
+      --gadget-compress)
+        [[ $# -ge 2 ]] || die "--gadget-compress requires a value"
+        GADGET_COMPRESS="$2"
+        shift 2
+        ;;
       *)
         die "Unknown argument: $1 (use --help)"
         ;;
@@ -304,6 +312,28 @@ if missing:
 print("[*] Gadget libraries OK")
 PY
 
+  if [[ "$GADGET_COMPRESS" == "true" ]]; then
+    info "Compressing gadget libraries (xz)"
+    python3 - <<PY
+import lzma, time
+from pathlib import Path
+
+stage = Path(${stage@Q})
+prefix = ${GADGET_PREFIX@Q}
+ver = ${GADGET_VERSION@Q}
+for abi in ["arm","arm64","x86","x86_64"]:
+    src = stage / f"{prefix}-{ver}-android-{abi}.so"
+    dst = src.with_name(src.name + ".xz")
+    data = src.read_bytes()
+    t = time.monotonic()
+    # Plain LZMA2 with CRC64: both are supported by the XzUnpacker in the system liblzma.
+    # Preset 6 keeps the decoder dictionary (8 MiB) small for the companion.
+    dst.write_bytes(lzma.compress(data, format=lzma.FORMAT_XZ, check=lzma.CHECK_CRC64, preset=6))
+    src.unlink()
+    print(f"[*] {dst.name}: {len(data)} -> {dst.stat().st_size} bytes ({time.monotonic() - t:.1f}s)")
+PY
+  fi
+
   chmod 0755 "$stage/service.sh" 2>/dev/null || true
 
   mkdir -p "$ROOT_DIR/out"
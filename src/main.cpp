@@ -1,21 +1,34 @@
 #include <jni.h>
 #include <thread>
 #include <unistd.h>
+#include <fcntl.h>
+#include <elf.h>
+#include <link.h>
+#include <android/dlext.h>
 #include <fstream>
 #include <sstream>
 #include <array>
+#include <algorithm>
+#include <vector>
 #include <filesystem>
 #include <regex>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/memfd.h>
 #include <cerrno>
 #include <cstring>
 #include <cstdint>
 #include <ctime>
+#include <map>
+#include <mutex>
 
 #include "zygisk.hpp"
 #include "log.h"
-#include "xdl.h"
+#include "xdl.hpp"
 #include "nlohmann/json.hpp"
+#include "xdl/xdl_lzma.h"
 
 #define BUFFER_SIZE (64 * 1024)
 
@@ -25,6 +38,66 @@ using zygisk::ServerSpecializeArgs;
 
 using json = nlohmann::json;
 
+// How the gadget's RELRO segment is shared between launches (see dlopen_with_relro()).
+enum RelroMode : uint32_t {
+    RELRO_NONE = 0,   // plain dlopen()
+    RELRO_WRITE = 1,  // load at the reserved address and serialize RELRO into relro_path
+    RELRO_USE = 2,    // load at the reserved address and map identical RELRO pages from relro_path
+};
+
+struct RelroPlan {
+    RelroMode mode = RELRO_NONE;
+    uint64_t address = 0;  // reserved load address of the gadget
+    uint64_t size = 0;     // size of the reservation
+    std::string name;      // RELRO file name, relative to the app data dir
+};
+
+struct PayloadSpec {
+    std::string name;
+    std::vector<std::string> depends;
+};
+
+// Everything the injection needs, received from the companion in preAppSpecialize.
+// It is moved into the injection so the module object holds nothing afterwards.
+struct InjectionPlan {
+    std::string package_name;
+    std::string app_data_dir;
+    std::string gadget_name;
+    std::string gadget_config_name;  // staged "<gadget>.config.so", empty if none
+    uint delay = 0;
+    bool zero_residue = false;  // unload the module from the target once the injection is done
+    RelroPlan relro;
+    std::vector<PayloadSpec> payloads;  // staged payloads, in load order
+    std::string symoff_name;  // staged symbol offset table, empty if none
+    std::string symcache_name;  // staged symbol cache, empty if none
+};
+
+// Upper bound on payloads accepted from the companion.
+static constexpr uint32_t kMaxPayloads = 64;
+
+// Staged name of the symbol offset table.
+static constexpr const char* kSymoffName = "symbols.symoff";
+
+// Staged name of the symbol cache.
+static constexpr const char* kSymcacheName = "symbols.symcache";
+
+#ifdef __arm__
+#define PAYLOAD_ABI "armeabi-v7a"
+#elifdef __aarch64__
+#define PAYLOAD_ABI "arm64-v8a"
+#elifdef __i386__
+#define PAYLOAD_ABI "x86"
+#elifdef __x86_64__
+#define PAYLOAD_ABI "x86_64"
+#endif
+
+#ifdef __LP64__
+// Fixed reservation for the gadget image. A RELRO file is only usable at the address it was
+// written for, so every launch must load the gadget at the same place. This sits well below
+// the mmap area and well above the ART heap and boot image.
+static constexpr uint64_t kGadgetReserveAddress = 0x4000000000ULL;
+#endif
+
 static bool write_full(int fd, const void* buf, size_t len) {
     const auto* p = static_cast<const uint8_t*>(buf);
     while (len > 0) {
@@ -108,62 +181,246 @@ static long long monotonic_ms() {
     return static_cast<long long>(ts.tv_sec) * 1000LL + ts.tv_nsec / 1000000LL;
 }
 
-void injection_thread(const char* app_data_dir, const char* frida_gadget_name, uint time_to_sleep) {
-    LOGD("Gadget injection start at %lld ms, app_data_dir: %s, gadget name: %s, usleep: %u",
-         monotonic_ms(), app_data_dir, frida_gadget_name, time_to_sleep);
-    if (time_to_sleep > 0) {
-        usleep(time_to_sleep);
-        LOGD("Gadget injection delay finished at %lld ms", monotonic_ms());
+static std::string relro_name_for(const std::string& gadget_name, const std::string& gadget_key) {
+    return gadget_name.substr(0, gadget_name.find_last_of('.')) + "." + gadget_key + ".relro";
+}
+
+static void* reserve_address(uint64_t address, uint64_t size) {
+    void* want = reinterpret_cast<void*>(static_cast<uintptr_t>(address));
+    // Hint only: never clobber an existing mapping, give up if the range is taken.
+    void* addr = mmap(want, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (addr == MAP_FAILED) return nullptr;
+    if (addr != want) {
+        munmap(addr, size);
+        return nullptr;
+    }
+    return addr;
+}
+
+// Load the gadget at a fixed address and share its RELRO pages with other launches, the same
+// way WebView does. The first launch writes the relocated RELRO segment to relro_path; later
+// launches map the identical pages from that file instead of keeping private dirty copies.
+// The linker compares every page before replacing it, so a stale file is harmless.
+static void* dlopen_with_relro(const std::string& gadget_path, const std::string& relro_path, const RelroPlan& relro) {
+    void* reserved = reserve_address(relro.address, relro.size);
+    if (!reserved) {
+        LOGW("Cannot reserve %#llx (+%#llx) for gadget, RELRO sharing disabled",
+             static_cast<unsigned long long>(relro.address), static_cast<unsigned long long>(relro.size));
+        return nullptr;
+    }
+
+    std::string tmp_path = relro_path + ".tmp";
+    int relro_fd;
+    if (relro.mode == RELRO_WRITE) {
+        relro_fd = open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    } else {
+        relro_fd = open(relro_path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    if (relro_fd < 0) {
+        LOGW("open RELRO file failed: %s", strerror(errno));
+        munmap(reserved, relro.size);
+        return nullptr;
+    }
+
+    android_dlextinfo info{};
+    info.flags = ANDROID_DLEXT_RESERVED_ADDRESS |
+                 (relro.mode == RELRO_WRITE ? ANDROID_DLEXT_WRITE_RELRO : ANDROID_DLEXT_USE_RELRO);
+    info.reserved_addr = reserved;
+    info.reserved_size = relro.size;
+    info.relro_fd = relro_fd;
+
+    dlerror();  // clear
+    void* handle = android_dlopen_ext(gadget_path.c_str(), RTLD_NOW, &info);
+    close(relro_fd);
+    if (handle) {
+        if (relro.mode == RELRO_WRITE && rename(tmp_path.c_str(), relro_path.c_str()) != 0) {
+            LOGW("rename(%s) failed: %s", tmp_path.c_str(), strerror(errno));
+            unlink(tmp_path.c_str());
+        }
+        return handle;
+    }
+
+    const char* err = dlerror();
+    LOGW("android_dlopen_ext (RELRO %s) failed: %s",
+         relro.mode == RELRO_WRITE ? "write" : "use", err ? err : "(null)");
+    // Drop the file so the next launch writes a fresh one.
+    unlink(relro.mode == RELRO_WRITE ? tmp_path.c_str() : relro_path.c_str());
+    munmap(reserved, relro.size);
+    return nullptr;
+}
+
+// Ask the kernel to start reading the whole file in the background. The readahead for every
+// staged library is in flight at once, so it overlaps the delay and the earlier dlopen() calls.
+static void prefetch_file(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+}
+
+// Name of a dependency of spec that is not in done, or nullptr if all of them are.
+static const std::string* missing_dependency(const PayloadSpec& spec, const std::vector<std::string>& done) {
+    for (const auto& dep : spec.depends) {
+        if (std::find(done.begin(), done.end(), dep) == done.end()) return &dep;
+    }
+    return nullptr;
+}
+
+// Hand a staged symbol file to the xDL linked into a payload, if it exports the setter
+// (xdl_set_symoff_file() or xdl_set_symcache_file()). xDL maps the file, so the staged file
+// can be removed like the others.
+static void set_payload_symbol_file(void* payload, const char* setter, const std::string& path) {
+    using set_file_t = int (*)(const char*);
+    auto set_file = reinterpret_cast<set_file_t>(dlsym(payload, setter));
+    if (!set_file) return;
+    if (set_file(path.c_str()) != 0) {
+        LOGW("Payload %s(%s) failed", setter, path.c_str());
+    }
+}
+
+// Load the staged payloads in the order given by the companion (dependencies first).
+// A payload whose dependency failed to load is skipped.
+static void load_payloads(const std::string& app_dir, const std::vector<PayloadSpec>& payloads,
+                          const std::string& symoff_path, const std::string& symcache_path) {
+    std::vector<std::string> loaded;
+    for (const auto& spec : payloads) {
+        const std::string& name = spec.name;
+        if (const std::string* dep = missing_dependency(spec, loaded)) {
+            LOGE("Skip payload %s: dependency %s is not loaded", name.c_str(), dep->c_str());
+            continue;
+        }
+        std::string path = app_dir + "/" + name;
+        dlerror();  // clear
+        LOGD("Payload dlopen start at %lld ms: %s", monotonic_ms(), path.c_str());
+        if (void* payload = dlopen(path.c_str(), RTLD_NOW)) {
+            LOGD("Payload dlopen done at %lld ms", monotonic_ms());
+            if (!symoff_path.empty()) set_payload_symbol_file(payload, "xdl_set_symoff_file", symoff_path);
+            if (!symcache_path.empty()) set_payload_symbol_file(payload, "xdl_set_symcache_file", symcache_path);
+            loaded.push_back(name);
+        } else {
+            const char* err = dlerror();
+            LOGE("Payload dlopen failed: %s", err ? err : "(null)");
+        }
     }
+}
+
+// Remove staged files by their exact names; no directory scan.
+static void remove_staged_files(const std::string& app_dir, const std::vector<std::string>& names) {
+    int dir_fd = open(app_dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) {
+        LOGW("open(%s) failed: %s", app_dir.c_str(), strerror(errno));
+        return;
+    }
+    for (const auto& name : names) {
+        if (unlinkat(dir_fd, name.c_str(), 0) != 0 && errno != ENOENT) {
+            LOGW("unlink(%s/%s) failed: %s", app_dir.c_str(), name.c_str(), strerror(errno));
+        }
+    }
+    close(dir_fd);
+}
+
+// Cleanup is not timing-critical: run it after the loads have returned, at the lowest priority.
+static void cleanup_thread(std::string app_dir, std::vector<std::string> names) {
+    setpriority(PRIO_PROCESS, gettid(), 19);
+    remove_staged_files(app_dir, names);
+    LOGD("Removed %zu staged files at %lld ms", names.size(), monotonic_ms());
+}
+
+static void schedule_cleanup(const InjectionPlan& plan, std::string app_dir, std::vector<std::string> names) {
+    if (names.empty()) return;
+    if (plan.zero_residue && plan.delay == 0) {
+        // The module is unmapped right after we return, so no thread of ours may outlive this call.
+        remove_staged_files(app_dir, names);
+    } else {
+        std::thread t(cleanup_thread, std::move(app_dir), std::move(names));
+        t.detach();
+    }
+}
+
+void injection_thread(InjectionPlan plan) {
+    const RelroPlan& relro = plan.relro;
+    const std::vector<PayloadSpec>& payloads = plan.payloads;
+    LOGD("Gadget injection start at %lld ms, app_data_dir: %s, gadget name: %s, usleep: %u, payloads: %zu",
+         monotonic_ms(), plan.app_data_dir.c_str(), plan.gadget_name.c_str(), plan.delay, payloads.size());
 
-    std::string app_dir = normalize_dir(app_data_dir ? std::string(app_data_dir) : std::string());
+    std::string app_dir = normalize_dir(plan.app_data_dir);
     if (app_dir.empty()) {
         LOGE("app_data_dir is empty, skip injection");
         return;
     }
-    std::string gadget_path = app_dir + "/" + std::string(frida_gadget_name);
+
+    // Staged files removed on every exit path. The gadget and its config are only added once the
+    // gadget is loaded: if loading fails, they are kept so users can inspect permissions/ownership.
+    std::vector<std::string> leftovers;
+    if (!plan.symoff_name.empty()) leftovers.push_back(plan.symoff_name);
+    if (!plan.symcache_name.empty()) leftovers.push_back(plan.symcache_name);
+    for (const auto& spec : payloads) leftovers.push_back(spec.name);
+
+    prefetch_file(app_dir + "/" + plan.gadget_name);
+    for (const auto& spec : payloads) prefetch_file(app_dir + "/" + spec.name);
+
+    if (plan.delay > 0) {
+        usleep(plan.delay);
+        LOGD("Gadget injection delay finished at %lld ms", monotonic_ms());
+    }
+
+    std::string gadget_path = app_dir + "/" + plan.gadget_name;
 
     std::ifstream file(gadget_path);
     if (file) {
         LOGD("Gadget is ready to load from %s at %lld ms", gadget_path.c_str(), monotonic_ms());
     } else {
         LOGD("Cannot find gadget in %s", gadget_path.c_str());
+        schedule_cleanup(plan, std::move(app_dir), std::move(leftovers));
         return;
     }
 
+    void* handle = nullptr;
+    bool force_loaded = false;  // by the xDL fallback, whose handle does not outlive its scope
+    if (relro.mode != RELRO_NONE) {
+        std::string relro_path = app_dir + "/" + relro.name;
+        LOGD("Gadget android_dlopen_ext start at %lld ms: RELRO %s %s",
+             monotonic_ms(), relro.mode == RELRO_WRITE ? "write" : "use", relro_path.c_str());
+        handle = dlopen_with_relro(gadget_path, relro_path, relro);
+        if (handle) LOGD("Gadget android_dlopen_ext done at %lld ms", monotonic_ms());
+    }
+
     // Prefer dlopen() here. xDL's xdl_open() can return NULL even if the library is
     // actually loaded (pathname mismatch like /data/user/0 vs /data/data symlink).
-    dlerror();  // clear
-    LOGD("Gadget dlopen start at %lld ms: %s", monotonic_ms(), gadget_path.c_str());
-    void* handle = dlopen(gadget_path.c_str(), RTLD_NOW);
-    if (handle) {
-        LOGD("Gadget dlopen done at %lld ms", monotonic_ms());
-    } else {
-        const char* err = dlerror();
-        LOGE("dlopen failed: %s", err ? err : "(null)");
-        // Fallback: try xDL force load for edge cases.
-        LOGD("Gadget xdl_open fallback start at %lld ms", monotonic_ms());
-        void* xh = xdl_open(gadget_path.c_str(), XDL_TRY_FORCE_LOAD);
-        if (xh) {
-            LOGD("Gadget xdl_open done at %lld ms", monotonic_ms());
-            handle = xh;
+    if (!handle) {
+        dlerror();  // clear
+        LOGD("Gadget dlopen start at %lld ms: %s", monotonic_ms(), gadget_path.c_str());
+        handle = dlopen(gadget_path.c_str(), RTLD_NOW);
+        if (handle) {
+            LOGD("Gadget dlopen done at %lld ms", monotonic_ms());
         } else {
-            LOGE("Frida-gadget failed to load (xdl_open returned NULL)");
+            const char* err = dlerror();
+            LOGE("dlopen failed: %s", err ? err : "(null)");
+            // Fallback: try xDL force load for edge cases.
+            LOGD("Gadget xdl_open fallback start at %lld ms", monotonic_ms());
+            // The force-loaded library stays loaded; only the xDL bookkeeping is released.
+            xdl::handle xh = xdl::handle::open(gadget_path.c_str(), XDL_TRY_FORCE_LOAD);
+            if (xh) {
+                LOGD("Gadget xdl_open done at %lld ms", monotonic_ms());
+                force_loaded = true;
+            } else {
+                LOGE("Frida-gadget failed to load (xdl_open returned NULL)");
+            }
         }
     }
 
-    // Only cleanup files when gadget is successfully loaded.
-    // If load fails, keep the file so users can inspect permissions/ownership.
-    if (handle) {
-        unlink(gadget_path.c_str());
-        // If there's a frida-gadget config file, remove it too.
-        std::regex pattern(".*-gadget.*\\.config\\.so$");
-        std::string frida_config_name = find_matching_file(app_dir, pattern);
-        if (!frida_config_name.empty()) {
-            std::string frida_config_path = app_dir + "/" + frida_config_name;
-            unlink(frida_config_path.c_str());
-        }
+    // The gadget is loaded, so its files can go too.
+    if (handle || force_loaded) {
+        leftovers.push_back(plan.gadget_name);
+        if (!plan.gadget_config_name.empty()) leftovers.push_back(plan.gadget_config_name);
     }
+
+    // Payloads go in the same pass, right after the gadget.
+    std::string symoff_path = plan.symoff_name.empty() ? "" : app_dir + "/" + plan.symoff_name;
+    std::string symcache_path = plan.symcache_name.empty() ? "" : app_dir + "/" + plan.symcache_name;
+    load_payloads(app_dir, payloads, symoff_path, symcache_path);
+
+    schedule_cleanup(plan, std::move(app_dir), std::move(leftovers));
 }
 
 class MyModule : public zygisk::ModuleBase {
@@ -194,16 +451,17 @@ public:
             LOGD("preAppSpecialize matched target %s at %lld ms", package_name, monotonic_ms());
             _enable_gadget_injection = true;
             write(fd, &_enable_gadget_injection, sizeof(_enable_gadget_injection));
-
-            _target_package_name = strdup(target_package_name.c_str());
+            _plan.package_name = package_name;
 
             // Use the system provided app_data_dir to support multi-user (/data/user/<id>/...)
-            // and avoid hardcoding /data/data.
+            // and avoid hardcoding /data/data. Without it, the companion stages into
+            // /data/data/<package>, so the injection looks there too.
+            _plan.app_data_dir = std::string("/data/data/") + package_name;
             if (args->app_data_dir) {
                 auto app_dir = _env->GetStringUTFChars(args->app_data_dir, nullptr);
                 if (app_dir) {
                     writeString(fd, app_dir);
-                    _app_data_dir = strdup(app_dir);
+                    _plan.app_data_dir = app_dir;
                     _env->ReleaseStringUTFChars(args->app_data_dir, app_dir);
                 } else {
                     writeString(fd, "");
@@ -214,18 +472,54 @@ public:
 
             uint delay;
             read(fd, &delay, sizeof(delay));
-            _delay = delay;
-            LOGD("Gadget config for %s: delay=%u", package_name, _delay);
+            _plan.delay = delay;
+            read(fd, &_plan.zero_residue, sizeof(_plan.zero_residue));
+            LOGD("Gadget config for %s: delay=%u, zero_residue=%s",
+                 package_name, _plan.delay, _plan.zero_residue ? "true" : "false");
 
             std::string frida_gadget_name = readString(fd);
             if (frida_gadget_name.empty()) {
                 LOGE("Companion did not provide gadget name, skip injection");
                 _enable_gadget_injection = false;
+                _plan = InjectionPlan{};
+                _api->setOption(zygisk::Option::DLCLOSE_MODULE_LIBRARY);
                 close(fd);
                 _env->ReleaseStringUTFChars(args->nice_name, package_name);
                 return;
             }
-            _frida_gadget_name = strdup(frida_gadget_name.c_str());
+            _plan.gadget_name = std::move(frida_gadget_name);
+            _plan.gadget_config_name = readString(fd);
+
+            RelroPlan& relro = _plan.relro;
+            if (!read_full(fd, &relro.mode, sizeof(relro.mode)) ||
+                !read_full(fd, &relro.address, sizeof(relro.address)) ||
+                !read_full(fd, &relro.size, sizeof(relro.size))) {
+                relro = RelroPlan{};
+            }
+            if (relro.mode != RELRO_NONE) {
+                relro.name = readString(fd);
+                if (relro.name.empty()) relro = RelroPlan{};
+            }
+            LOGD("Gadget RELRO plan for %s: mode=%u, address=%#llx, size=%#llx",
+                 package_name, relro.mode,
+                 static_cast<unsigned long long>(relro.address),
+                 static_cast<unsigned long long>(relro.size));
+
+            uint32_t payload_count = 0;
+            if (read_full(fd, &payload_count, sizeof(payload_count)) && payload_count <= kMaxPayloads) {
+                for (uint32_t n = 0; n < payload_count; n++) {
+                    PayloadSpec spec{readString(fd), {}};
+                    uint32_t depend_count = 0;
+                    if (spec.name.empty() || !read_full(fd, &depend_count, sizeof(depend_count)) ||
+                        depend_count > kMaxPayloads) {
+                        break;
+                    }
+                    for (uint32_t k = 0; k < depend_count; k++) spec.depends.push_back(readString(fd));
+                    _plan.payloads.push_back(std::move(spec));
+                }
+            }
+            _plan.symoff_name = readString(fd);
+            _plan.symcache_name = readString(fd);
 
             close(fd);
         } else {
@@ -242,18 +536,34 @@ public:
 
     void postAppSpecialize(const AppSpecializeArgs *args) override {
         if (_enable_gadget_injection) {
+            // Move the plan out so nothing stays behind in the module object.
+            InjectionPlan plan = std::move(_plan);
+            _plan = InjectionPlan{};
+            bool synchronous = plan.delay == 0;
+            bool zero_residue = plan.zero_residue;
             LOGD("postAppSpecialize enter for %s at %lld ms, delay=%u",
-                 _target_package_name ? _target_package_name : "(unknown)",
+                 plan.package_name.c_str(),
                  monotonic_ms(),
-                 _delay);
-            if (_delay == 0) {
+                 plan.delay);
+            if (synchronous) {
                 LOGD("Loading Gadget synchronously for zero-delay target");
-                injection_thread(_app_data_dir, _frida_gadget_name, _delay);
+                injection_thread(std::move(plan));
             } else {
                 LOGD("Loading Gadget on detached thread because delay is non-zero");
-                std::thread t(injection_thread, _app_data_dir, _frida_gadget_name, _delay);
+                std::thread t(injection_thread, std::move(plan));
                 t.detach();
             }
+
+            if (zero_residue) {
+                if (synchronous) {
+                    // Nothing of ours runs after this point: let Zygisk unmap the module.
+                    LOGD("Zero-residue: unloading module after injection");
+                    _api->setOption(zygisk::Option::DLCLOSE_MODULE_LIBRARY);
+                } else {
+                    // The detached thread still executes module code, so it must stay mapped.
+                    LOGW("Zero-residue: module kept loaded because the injection is delayed");
+                }
+            }
         }
     }
 
@@ -261,10 +571,7 @@ private:
     Api* _api{};
     JNIEnv* _env{};
     bool _enable_gadget_injection = false;
-    char* _target_package_name{};
-    char* _app_data_dir{};
-    uint _delay{};
-    char* _frida_gadget_name{};
+    InjectionPlan _plan;
 
 };
 
@@ -329,6 +636,421 @@ static void chown_like_dir(const char* file_path, const char* dir_path) {
     }
 }
 
+// Program headers of an ELF file, empty if it is not one of our class.
+static std::vector<ElfW(Phdr)> read_elf_phdrs(int fd) {
+    std::vector<ElfW(Phdr)> phdrs;
+    ElfW(Ehdr) ehdr{};
+    if (pread(fd, &ehdr, sizeof(ehdr), 0) != sizeof(ehdr) ||
+        memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0 ||
+        ehdr.e_phentsize != sizeof(ElfW(Phdr)) || ehdr.e_phnum == 0) {
+        return phdrs;
+    }
+    phdrs.resize(ehdr.e_phnum);
+    size_t phdrs_size = phdrs.size() * sizeof(ElfW(Phdr));
+    if (pread(fd, phdrs.data(), phdrs_size, static_cast<off_t>(ehdr.e_phoff)) != static_cast<ssize_t>(phdrs_size)) {
+        phdrs.clear();
+    }
+    return phdrs;
+}
+
+// Page-aligned size of the address range covered by the PT_LOAD segments of an ELF file.
+static uint64_t elf_load_span(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    std::vector<ElfW(Phdr)> phdrs = read_elf_phdrs(fd);
+    close(fd);
+
+    uint64_t min_vaddr = UINT64_MAX, max_vaddr = 0;
+    for (const auto& phdr : phdrs) {
+        if (phdr.p_type != PT_LOAD) continue;
+        min_vaddr = std::min<uint64_t>(min_vaddr, phdr.p_vaddr);
+        max_vaddr = std::max<uint64_t>(max_vaddr, phdr.p_vaddr + phdr.p_memsz);
+    }
+    if (min_vaddr >= max_vaddr) return 0;
+    auto page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    min_vaddr &= ~(page_size - 1);
+    max_vaddr = (max_vaddr + page_size - 1) & ~(page_size - 1);
+    return max_vaddr - min_vaddr;
+}
+
+static std::string to_hex(const uint8_t* data, size_t len) {
+    static constexpr char kDigits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(len * 2);
+    for (size_t n = 0; n < len; n++) {
+        hex.push_back(kDigits[data[n] >> 4]);
+        hex.push_back(kDigits[data[n] & 0xf]);
+    }
+    return hex;
+}
+
+// Hex NT_GNU_BUILD_ID of an ELF file, empty if it has none.
+static std::string elf_build_id(int fd) {
+    for (const auto& phdr : read_elf_phdrs(fd)) {
+        if (phdr.p_type != PT_NOTE || phdr.p_filesz == 0 || phdr.p_filesz > 64 * 1024) continue;
+        std::vector<uint8_t> notes(phdr.p_filesz);
+        if (pread(fd, notes.data(), notes.size(), static_cast<off_t>(phdr.p_offset)) !=
+            static_cast<ssize_t>(notes.size())) {
+            continue;
+        }
+        size_t off = 0;
+        while (off + sizeof(ElfW(Nhdr)) <= notes.size()) {
+            ElfW(Nhdr) nhdr{};
+            memcpy(&nhdr, notes.data() + off, sizeof(nhdr));
+            size_t name_off = off + sizeof(nhdr);
+            size_t desc_off = name_off + ((static_cast<size_t>(nhdr.n_namesz) + 3) & ~static_cast<size_t>(3));
+            size_t next = desc_off + ((static_cast<size_t>(nhdr.n_descsz) + 3) & ~static_cast<size_t>(3));
+            if (next > notes.size()) break;
+            if (nhdr.n_type == NT_GNU_BUILD_ID && nhdr.n_namesz == 4 && nhdr.n_descsz > 0 &&
+                memcmp(notes.data() + name_off, "GNU", 4) == 0) {
+                return to_hex(notes.data() + desc_off, nhdr.n_descsz);
+            }
+            off = next;
+        }
+    }
+    return "";
+}
+
+// 64-bit FNV-1a of the whole file, empty on error.
+static std::string file_content_hash(int fd, size_t size) {
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) return "";
+    madvise(data, size, MADV_SEQUENTIAL);
+    uint64_t h = 0xcbf29ce484222325ULL;
+    const auto* p = static_cast<const uint8_t*>(data);
+    for (size_t n = 0; n < size; n++) {
+        h ^= p[n];
+        h *= 0x100000001b3ULL;
+    }
+    munmap(data, size);
+    uint8_t bytes[sizeof(h)];
+    for (size_t n = 0; n < sizeof(h); n++) bytes[n] = static_cast<uint8_t>(h >> (56 - 8 * n));
+    return to_hex(bytes, sizeof(bytes));
+}
+
+// Identity of a gadget build: its build-id, or a hash of its contents for builds without one.
+// A RELRO file named after it can only be picked up by the exact build that wrote it.
+// The key is computed once per file version and boot.
+static std::string gadget_build_key(const std::string& path) {
+    static std::mutex lock;
+    static std::map<std::string, std::string> keys;  // path, size and mtime -> key
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return "";
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return "";
+    }
+    std::string version = path + ":" + std::to_string(st.st_size) + ":" + std::to_string(st.st_mtim.tv_sec) + "." +
+                          std::to_string(st.st_mtim.tv_nsec);
+
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = keys.find(version);
+    if (it == keys.end()) {
+        std::string key = elf_build_id(fd);
+        if (key.empty()) key = file_content_hash(fd, static_cast<size_t>(st.st_size));
+        it = keys.emplace(std::move(version), std::move(key)).first;
+    }
+    close(fd);
+    return it->second;
+}
+
+static RelroPlan make_relro_plan(const std::string& gadget_path, const std::string& frida_gadget_name,
+                                 const std::string& app_data_dir) {
+    RelroPlan relro;
+#ifdef __LP64__
+    std::string gadget_key = gadget_build_key(gadget_path);
+    if (gadget_key.empty()) {
+        LOGW("Cannot identify gadget build %s, RELRO sharing disabled", gadget_path.c_str());
+        return relro;
+    }
+    relro.size = elf_load_span(gadget_path);
+    if (relro.size == 0) {
+        LOGW("Cannot compute load span of %s, RELRO sharing disabled", gadget_path.c_str());
+        return relro;
+    }
+    relro.address = kGadgetReserveAddress;
+
+    // The RELRO file is named after the gadget build, so a new build starts a fresh file.
+    relro.name = relro_name_for(frida_gadget_name, gadget_key);
+    std::string relro_path = app_data_dir + "/" + relro.name;
+    struct stat relro_st{};
+    relro.mode = (stat(relro_path.c_str(), &relro_st) == 0 && relro_st.st_size > 0) ? RELRO_USE : RELRO_WRITE;
+#else
+    // 32-bit address spaces are too crowded for a fixed reservation to succeed reliably.
+    (void)gadget_path;
+    (void)frida_gadget_name;
+    (void)app_data_dir;
+#endif
+    return relro;
+}
+
+// Whether a config entry targets this ABI: entries without an "abi" list target all of them.
+static bool abi_matches(const json& entry) {
+    if (!entry.contains("abi") || !entry["abi"].is_array()) return true;
+    for (const auto& abi : entry["abi"]) {
+        if (abi.is_string() && abi.get<std::string>() == PAYLOAD_ABI) return true;
+    }
+    return false;
+}
+
+// Parse the "payloads" list of the module config: entries that do not target this ABI are
+// dropped, and the rest are returned in dependency order (config order among independent
+// entries). Entries with a missing dependency or in a dependency cycle are dropped too.
+static std::vector<PayloadSpec> resolve_payloads(const json& j) {
+    std::vector<PayloadSpec> order;
+    if (!j.contains("payloads") || !j["payloads"].is_array()) return order;
+
+    std::vector<PayloadSpec> specs;
+    for (const auto& entry : j["payloads"]) {
+        if (!entry.is_object() || !entry.contains("name") || !entry["name"].is_string()) {
+            LOGW("Ignore malformed payload entry: %s", entry.dump().c_str());
+            continue;
+        }
+        std::string name = entry["name"];
+        if (name.empty() || name.find('/') != std::string::npos) {
+            LOGW("Ignore payload with invalid name: %s", name.c_str());
+            continue;
+        }
+        if (!abi_matches(entry)) continue;
+        PayloadSpec spec{name, {}};
+        if (entry.contains("depends") && entry["depends"].is_array()) {
+            for (const auto& dep : entry["depends"]) {
+                if (dep.is_string()) spec.depends.push_back(dep.get<std::string>());
+            }
+        }
+        specs.push_back(std::move(spec));
+    }
+
+    // Kahn's algorithm; always pick the earliest ready entry to keep config order stable.
+    std::vector<bool> done(specs.size(), false);
+    bool progress = true;
+    while (progress && order.size() < specs.size()) {
+        progress = false;
+        for (size_t n = 0; n < specs.size(); n++) {
+            if (done[n]) continue;
+            bool ready = true;
+            for (const auto& dep : specs[n].depends) {
+                auto it = std::find_if(order.begin(), order.end(),
+                                       [&dep](const PayloadSpec& spec) { return spec.name == dep; });
+                if (it == order.end()) ready = false;
+            }
+            if (!ready) continue;
+            done[n] = true;
+            order.push_back(specs[n]);
+            progress = true;
+            break;
+        }
+    }
+    for (size_t n = 0; n < specs.size(); n++) {
+        if (!done[n]) LOGE("Drop payload %s: missing or cyclic dependency", specs[n].name.c_str());
+    }
+    if (order.size() > kMaxPayloads) order.resize(kMaxPayloads);
+    return order;
+}
+
+struct SymbolSpec {
+    std::string path;
+    std::vector<std::string> names;
+};
+
+// Parse the "symbols" list of the module config: ELF files (absolute paths) and the symbols
+// to resolve in each. Entries that do not target this ABI are dropped.
+static std::vector<SymbolSpec> resolve_symbol_specs(const json& j) {
+    std::vector<SymbolSpec> specs;
+    if (!j.contains("symbols") || !j["symbols"].is_array()) return specs;
+
+    for (const auto& entry : j["symbols"]) {
+        if (!entry.is_object() || !entry.contains("path") || !entry["path"].is_string() ||
+            !entry.contains("names") || !entry["names"].is_array()) {
+            LOGW("Ignore malformed symbols entry: %s", entry.dump().c_str());
+            continue;
+        }
+        std::string path = entry["path"];
+        if (path.empty() || path[0] != '/') {
+            LOGW("Ignore symbols entry with invalid path: %s", path.c_str());
+            continue;
+        }
+        if (!abi_matches(entry)) continue;
+        SymbolSpec spec{path, {}};
+        for (const auto& name : entry["names"]) {
+            if (name.is_string() && !name.get<std::string>().empty()) spec.names.push_back(name.get<std::string>());
+        }
+        if (!spec.names.empty()) specs.push_back(std::move(spec));
+    }
+    return specs;
+}
+
+// Path of the symbol offset table for the configured "symbols", resolving them on first use.
+// Like the decompressed gadget, this happens once per boot (and again only if the list changes):
+// every target process then gets the offsets instead of loading and scanning .symtab itself.
+static std::string symoff_table_path(const json& j, const std::string& module_dir) {
+    static std::mutex lock;
+    static std::string built;  // "symbols" list the table was built from
+
+    std::vector<SymbolSpec> specs = resolve_symbol_specs(j);
+    if (specs.empty()) return "";
+    std::string key = j["symbols"].dump();
+    std::string path = module_dir + "/symbols-" PAYLOAD_ABI ".symoff";
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (built == key) return path;
+
+    std::vector<std::vector<const char*>> names(specs.size());
+    std::vector<xdl_symoff_spec_t> c_specs(specs.size());
+    size_t names_cnt = 0;
+    for (size_t n = 0; n < specs.size(); n++) {
+        for (const auto& name : specs[n].names) names[n].push_back(name.c_str());
+        c_specs[n] = {specs[n].path.c_str(), names[n].data(), names[n].size()};
+        names_cnt += names[n].size();
+    }
+
+    long long start = monotonic_ms();
+    if (xdl_symoff_create(path.c_str(), c_specs.data(), c_specs.size()) != 0) {
+        LOGE("Cannot create symbol offset table %s", path.c_str());
+        return "";
+    }
+    LOGI("Resolved %zu symbols of %zu libraries into %s in %lld ms",
+         names_cnt, specs.size(), path.c_str(), monotonic_ms() - start);
+    built = std::move(key);
+    return path;
+}
+
+// Parse the "symcache" list of the module config: ELF files (absolute paths) whose whole .symtab
+// is cached. Entries that do not target this ABI are dropped.
+static std::vector<std::string> resolve_symcache_paths(const json& j) {
+    std::vector<std::string> paths;
+    if (!j.contains("symcache") || !j["symcache"].is_array()) return paths;
+
+    for (const auto& entry : j["symcache"]) {
+        if (!entry.is_object() || !entry.contains("path") || !entry["path"].is_string()) {
+            LOGW("Ignore malformed symcache entry: %s", entry.dump().c_str());
+            continue;
+        }
+        std::string path = entry["path"];
+        if (path.empty() || path[0] != '/') {
+            LOGW("Ignore symcache entry with invalid path: %s", path.c_str());
+            continue;
+        }
+        if (abi_matches(entry)) paths.push_back(std::move(path));
+    }
+    return paths;
+}
+
+// Path of the symbol cache for the configured "symcache", extracting the tables on first use.
+// Built once per boot like the symbol offset table: target processes then map the tables
+// instead of opening, mapping or decompressing .symtab themselves.
+static std::string symcache_path(const json& j, const std::string& module_dir) {
+    static std::mutex lock;
+    static std::string built;  // "symcache" list the cache was built from
+
+    std::vector<std::string> paths = resolve_symcache_paths(j);
+    if (paths.empty()) return "";
+    std::string key = j["symcache"].dump();
+    std::string path = module_dir + "/symbols-" PAYLOAD_ABI ".symcache";
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (built == key) return path;
+
+    std::vector<const char*> elfs;
+    for (const auto& elf : paths) elfs.push_back(elf.c_str());
+
+    long long start = monotonic_ms();
+    if (xdl_symcache_create(path.c_str(), elfs.data(), elfs.size()) != 0) {
+        LOGE("Cannot create symbol cache %s", path.c_str());
+        return "";
+    }
+    LOGI("Cached .symtab of %zu libraries into %s in %lld ms", elfs.size(), path.c_str(), monotonic_ms() - start);
+    built = std::move(key);
+    return path;
+}
+
+static int create_memfd(const char* name) {
+    return static_cast<int>(syscall(__NR_memfd_create, name, MFD_CLOEXEC | MFD_ALLOW_SEALING));
+}
+
+// Anonymous in-memory file for the decompressed gadget: a sealed memfd, or an unlinked
+// file on the /dev tmpfs for kernels without memfd_create().
+static int create_staging_fd(const std::string& name) {
+    int fd = create_memfd(name.c_str());
+    if (fd >= 0) return fd;
+
+    std::string path = "/dev/." + name;
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd >= 0) unlink(path.c_str());
+    return fd;
+}
+
+static int write_to_fd_cb(const uint8_t* buf, size_t len, void* arg) {
+    return write_full(*static_cast<int*>(arg), buf, len) ? 0 : -1;
+}
+
+// Stream-decompress an xz file into an in-memory staging file. Returns the fd, or -1.
+static int decompress_to_staging_fd(const std::string& xz_path, const std::string& name) {
+    int src_fd = open(xz_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (src_fd < 0) {
+        LOGE("open(%s) failed: %s", xz_path.c_str(), strerror(errno));
+        return -1;
+    }
+    struct stat st{};
+    if (fstat(src_fd, &st) != 0 || st.st_size <= 0) {
+        close(src_fd);
+        return -1;
+    }
+    auto src_size = static_cast<size_t>(st.st_size);
+    void* src = mmap(nullptr, src_size, PROT_READ, MAP_PRIVATE, src_fd, 0);
+    close(src_fd);
+    if (src == MAP_FAILED) {
+        LOGE("mmap(%s) failed: %s", xz_path.c_str(), strerror(errno));
+        return -1;
+    }
+    madvise(src, src_size, MADV_SEQUENTIAL);
+
+    int fd = create_staging_fd(name);
+    if (fd < 0) {
+        LOGE("Cannot create staging file for %s: %s", name.c_str(), strerror(errno));
+        munmap(src, src_size);
+        return -1;
+    }
+
+    long long start = monotonic_ms();
+    int r = xdl_lzma_decompress_stream(static_cast<const uint8_t*>(src), src_size, write_to_fd_cb, &fd);
+    long long elapsed = monotonic_ms() - start;
+    munmap(src, src_size);
+    if (r != 0) {
+        LOGE("Decompress %s failed", xz_path.c_str());
+        close(fd);
+        return -1;
+    }
+
+    // Nobody may modify the gadget behind our back for the rest of the boot.
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+
+    off_t out_size = lseek(fd, 0, SEEK_END);
+    LOGI("Decompressed %s: %zu -> %lld bytes in %lld ms (%.1f MB/s)",
+         name.c_str(), src_size, static_cast<long long>(out_size), elapsed,
+         elapsed > 0 ? static_cast<double>(out_size) / 1000.0 / static_cast<double>(elapsed) : 0.0);
+    return fd;
+}
+
+// Path of the decompressed gadget, decompressing it on first use. The companion process
+// lives for the whole boot, so this happens once per boot and later requests only read
+// from memory instead of flash.
+static std::string decompressed_gadget_path(const std::string& xz_path, const std::string& name) {
+    static std::mutex lock;
+    static std::map<std::string, int> staged;  // xz path -> staging fd
+
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = staged.find(xz_path);
+    if (it == staged.end()) {
+        int fd = decompress_to_staging_fd(xz_path, name);
+        if (fd < 0) return "";
+        it = staged.emplace(xz_path, fd).first;
+    }
+    return "/proc/self/fd/" + std::to_string(it->second);
+}
+
 static void companion_handler(int i) {
     std::string config_file_path = readString(i);
 
@@ -339,10 +1061,12 @@ static void companion_handler(int i) {
     std::string target_package_name = j["package"]["name"];
     uint delay = j["package"]["delay"];
     bool frida_config_mode = j["package"]["mode"]["config"];
-    LOGD("Companion config loaded: target=%s, delay=%u, config_mode=%s",
+    bool zero_residue = j["package"]["mode"].value("zero_residue", false);
+    LOGD("Companion config loaded: target=%s, delay=%u, config_mode=%s, zero_residue=%s",
          target_package_name.c_str(),
          delay,
-         frida_config_mode ? "true" : "false");
+         frida_config_mode ? "true" : "false",
+         zero_residue ? "true" : "false");
 
     writeString(i, target_package_name);
 
@@ -360,15 +1084,16 @@ static void companion_handler(int i) {
     }
 
     write(i, &delay, sizeof(delay));
+    write(i, &zero_residue, sizeof(zero_residue));
 
 #ifdef __arm__
-    std::regex frida_gadget_pattern(".*-gadget.*arm\\.so$");
+    std::regex frida_gadget_pattern(".*-gadget.*arm\\.so(\\.xz)?$");
 #elifdef __aarch64__
-    std::regex frida_gadget_pattern(".*-gadget.*arm64\\.so$");
+    std::regex frida_gadget_pattern(".*-gadget.*arm64\\.so(\\.xz)?$");
 #elifdef __i386__
-    std::regex frida_gadget_pattern(".*-gadget.*x86\\.so$");
+    std::regex frida_gadget_pattern(".*-gadget.*x86\\.so(\\.xz)?$");
 #elifdef __x86_64__
-    std::regex frida_gadget_pattern(".*-gadget.*x86_64\\.so$");
+    std::regex frida_gadget_pattern(".*-gadget.*x86_64\\.so(\\.xz)?$");
 #endif
     std::string module_dir = config_file_path.substr(0, config_file_path.rfind('/'));;
     std::string frida_gadget_name = find_matching_file(module_dir, frida_gadget_pattern);
@@ -378,8 +1103,17 @@ static void companion_handler(int i) {
     }
     std::string frida_gadget_path = module_dir + "/" + frida_gadget_name;
 
+    // Gadgets may ship xz-compressed; they are staged under their uncompressed name.
+    static constexpr std::string_view kXzSuffix = ".xz";
+    if (frida_gadget_name.ends_with(kXzSuffix)) {
+        frida_gadget_name.resize(frida_gadget_name.size() - kXzSuffix.size());
+        frida_gadget_path = decompressed_gadget_path(frida_gadget_path, frida_gadget_name);
+        if (frida_gadget_path.empty()) return;
+    }
+
     std::string copy_src;
     std::string copy_dst;
+    std::string staged_config_name;
     if (frida_config_mode) {
         std::regex frida_config_pattern(".*-gadget\\.config$");
         std::string frida_config_name = find_matching_file(module_dir, frida_config_pattern);
@@ -394,6 +1128,7 @@ static void companion_handler(int i) {
             LOGD("Copy config: %s -> %s", copy_src.c_str(), copy_dst.c_str());
             if (copy_file(copy_src.c_str(), copy_dst.c_str())) {
                 chown_like_dir(copy_dst.c_str(), app_data_dir.c_str());
+                staged_config_name = new_frida_config_name;
                 LOGD("Copy config done at %lld ms", monotonic_ms());
             }
         }
@@ -410,6 +1145,64 @@ static void companion_handler(int i) {
     // IMPORTANT: only send gadget name after copy completes.
     // Otherwise the app process may attempt to dlopen a partially copied ELF and crash.
     writeString(i, frida_gadget_name);
+    writeString(i, staged_config_name);
+
+    RelroPlan relro = make_relro_plan(frida_gadget_path, frida_gadget_name, app_data_dir);
+    (void)write_full(i, &relro.mode, sizeof(relro.mode));
+    (void)write_full(i, &relro.address, sizeof(relro.address));
+    (void)write_full(i, &relro.size, sizeof(relro.size));
+    if (relro.mode != RELRO_NONE) writeString(i, relro.name);
+
+    // Payloads live in <module_dir>/payloads/ and are staged next to the gadget.
+    // Dependents of a payload that could not be staged are not staged either.
+    std::vector<PayloadSpec> payloads;
+    std::vector<std::string> staged;
+    for (auto& spec : resolve_payloads(j)) {
+        if (const std::string* dep = missing_dependency(spec, staged)) {
+            LOGE("Skip payload %s: dependency %s is not staged", spec.name.c_str(), dep->c_str());
+            continue;
+        }
+        std::string src = module_dir + "/payloads/" + spec.name;
+        std::string dst = app_data_dir + "/" + spec.name;
+        LOGD("Copy payload: %s -> %s", src.c_str(), dst.c_str());
+        if (!copy_file(src.c_str(), dst.c_str())) continue;
+        chown_like_dir(dst.c_str(), app_data_dir.c_str());
+        staged.push_back(spec.name);
+        payloads.push_back(std::move(spec));
+    }
+    auto payload_count = static_cast<uint32_t>(payloads.size());
+    (void)write_full(i, &payload_count, sizeof(payload_count));
+    for (const auto& spec : payloads) {
+        writeString(i, spec.name);
+        auto depend_count = static_cast<uint32_t>(spec.depends.size());
+        (void)write_full(i, &depend_count, sizeof(depend_count));
+        for (const auto& dep : spec.depends) writeString(i, dep);
+    }
+
+    // The symbol offset table is staged next to the payloads. The payloads keep it mapped,
+    // which zero-residue mode does not allow.
+    std::string symoff_name;
+    std::string symoff_path = zero_residue ? "" : symoff_table_path(j, module_dir);
+    if (!symoff_path.empty()) {
+        std::string dst = app_data_dir + "/" + kSymoffName;
+        if (copy_file(symoff_path.c_str(), dst.c_str())) {
+            chown_like_dir(dst.c_str(), app_data_dir.c_str());
+            symoff_name = kSymoffName;
+        }
+    }
+    writeString(i, symoff_name);
+
+    // The symbol cache is staged the same way, for the same reason not in zero-residue mode.
+    std::string symcache_name;
+    std::string symcache_src = zero_residue ? "" : symcache_path(j, module_dir);
+    if (!symcache_src.empty()) {
+        std::string dst = app_data_dir + "/" + kSymcacheName;
+        if (copy_file(symcache_src.c_str(), dst.c_str())) {
+            chown_like_dir(dst.c_str(), app_data_dir.c_str());
+            symcache_name = kSymcacheName;
+        }
+    }
+    writeString(i, symcache_name);
 }
 
 REGISTER_ZYGISK_MODULE(MyModule)
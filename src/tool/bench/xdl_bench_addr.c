@@ -0,0 +1,89 @@
+// xdl_addr() on one library: total time of the first 1, 10, 100, ... lookups
+// on one cache. The first ones pay for opening the handle, loading the symbol
+// tables and building the address indexes; compare two builds to find the
+// number of lookups from which the index pays off.
+//
+// usage: xdl_bench_addr <library> [lookups]
+
+#include <dlfcn.h>
+#include <inttypes.h>
+#include <link.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "xdl.h"
+
+#define BENCH_ROUNDS 5
+#define BENCH_MARKS  10
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <library> [lookups]\n", argv[0]);
+    return 1;
+  }
+  size_t lookups = (argc > 2 ? (size_t)strtoul(argv[2], NULL, 10) : 100000);
+  if (0 == lookups) lookups = 1;
+
+  void *lib = dlopen(argv[1], RTLD_NOW);
+  void *handle = xdl_open(argv[1], XDL_DEFAULT);
+  xdl_info_t dlinfo;
+  if (NULL == lib || NULL == handle || 0 != xdl_info(handle, XDL_DI_DLINFO, &dlinfo)) {
+    fprintf(stderr, "cannot open %s\n", argv[1]);
+    return 1;
+  }
+
+  // random addresses inside the executable segments
+  uintptr_t starts[8], sizes[8], total = 0;
+  size_t segs = 0;
+  for (size_t i = 0; i < dlinfo.dlpi_phnum && segs < 8; i++) {
+    const ElfW(Phdr) *phdr = &dlinfo.dlpi_phdr[i];
+    if (PT_LOAD != phdr->p_type || 0 == (phdr->p_flags & PF_X)) continue;
+    starts[segs] = (uintptr_t)dlinfo.dli_fbase + phdr->p_vaddr;
+    sizes[segs] = phdr->p_memsz;
+    total += sizes[segs++];
+  }
+  xdl_close(handle);
+  if (0 == total) return 1;
+
+  void **addrs = malloc(lookups * sizeof(void *));
+  if (NULL == addrs) return 1;
+  uint64_t seed = 0x9e3779b97f4a7c15ULL;
+  for (size_t i = 0; i < lookups; i++) {
+    uintptr_t off = (uintptr_t)(bench_rand(&seed) % total);
+    size_t s = 0;
+    while (off >= sizes[s]) off -= sizes[s++];
+    addrs[i] = (void *)(starts[s] + off);
+  }
+
+  // total time of the first 1, 10, 100, ... lookups on a fresh cache, best of BENCH_ROUNDS
+  uint64_t total_ns[BENCH_MARKS];
+  for (size_t m = 0; m < BENCH_MARKS; m++) total_ns[m] = UINT64_MAX;
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    void *cache = NULL;
+    xdl_info_t info;
+    size_t mark = 0, next_mark = 1;
+
+    uint64_t t0 = bench_now_ns();
+    for (size_t i = 0; i < lookups; i++) {
+      xdl_addr(addrs[i], &info, &cache);
+      if (i + 1 == next_mark || i + 1 == lookups) {
+        uint64_t t = bench_now_ns() - t0;
+        if (t < total_ns[mark]) total_ns[mark] = t;
+        mark++;
+        next_mark *= 10;
+      }
+    }
+    xdl_addr_clean(&cache);
+  }
+
+  printf("%s:\n", argv[1]);
+  for (size_t m = 0, n = 1; m < BENCH_MARKS && n / 10 < lookups; m++, n *= 10) {
+    size_t done = (n < lookups ? n : lookups);
+    printf("  %8zu lookups: %10.1f us (%.1f ns/lookup)\n", done, (double)total_ns[m] / 1000.0,
+           (double)total_ns[m] / (double)done);
+  }
+  free(addrs);
+  dlclose(lib);
+  return 0;
+}
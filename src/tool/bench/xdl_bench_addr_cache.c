@@ -0,0 +1,93 @@
+// xdl_addr() across many ELFs on one cache: random addresses in the
+// executable segments of every loaded ELF, first a cold pass (opens and
+// caches a handle per ELF) and then the warm lookups, where finding the
+// cached handle is what differs between cache layouts.
+//
+// usage: xdl_bench_addr_cache <lookups> [library...]
+//
+// The libraries are dlopen()ed first to grow the process, e.g. a few
+// hundred from /system/lib64 gives the size of an app process.
+
+#include <dlfcn.h>
+#include <inttypes.h>
+#include <link.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "xdl.h"
+
+#define BENCH_ROUNDS   5
+#define BENCH_SEGS_MAX 65536
+
+typedef struct {
+  uintptr_t start[BENCH_SEGS_MAX];
+  uintptr_t size[BENCH_SEGS_MAX];
+  size_t cnt;
+  size_t elfs;
+  uintptr_t total;
+} bench_segs_t;
+
+static int bench_collect_cb(struct dl_phdr_info *info, size_t size, void *arg) {
+  (void)size;
+  bench_segs_t *segs = (bench_segs_t *)arg;
+  segs->elfs++;
+  for (size_t i = 0; i < info->dlpi_phnum && segs->cnt < BENCH_SEGS_MAX; i++) {
+    const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+    if (PT_LOAD != phdr->p_type || 0 == (phdr->p_flags & PF_X) || 0 == phdr->p_memsz) continue;
+    segs->start[segs->cnt] = (uintptr_t)info->dlpi_addr + phdr->p_vaddr;
+    segs->size[segs->cnt] = phdr->p_memsz;
+    segs->total += phdr->p_memsz;
+    segs->cnt++;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <lookups> [library...]\n", argv[0]);
+    return 1;
+  }
+  size_t lookups = (size_t)strtoul(argv[1], NULL, 10);
+  if (0 == lookups) lookups = 1;
+  for (int i = 2; i < argc; i++) {
+    if (NULL == dlopen(argv[i], RTLD_NOW)) fprintf(stderr, "cannot dlopen %s\n", argv[i]);
+  }
+
+  static bench_segs_t segs;
+  xdl_iterate_phdr(bench_collect_cb, &segs, XDL_DEFAULT);
+  if (0 == segs.total) return 1;
+
+  // uniform over the segments, so that every cached ELF gets hit
+  void **addrs = malloc(lookups * sizeof(void *));
+  if (NULL == addrs) return 1;
+  uint64_t seed = 0x9e3779b97f4a7c15ULL;
+  for (size_t i = 0; i < lookups; i++) {
+    size_t s = (size_t)(bench_rand(&seed) % segs.cnt);
+    addrs[i] = (void *)(segs.start[s] + (uintptr_t)(bench_rand(&seed) % segs.size[s]));
+  }
+
+  uint64_t cold_ns = UINT64_MAX, warm_ns = UINT64_MAX;
+  size_t found = 0;
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    void *cache = NULL;
+    xdl_info_t info;
+
+    uint64_t t0 = bench_now_ns();
+    for (size_t i = 0; i < lookups; i++) xdl_addr(addrs[i], &info, &cache);
+    uint64_t t1 = bench_now_ns();
+    found = 0;
+    for (size_t i = 0; i < lookups; i++) found += (size_t)xdl_addr(addrs[i], &info, &cache);
+    uint64_t t2 = bench_now_ns();
+    xdl_addr_clean(&cache);
+
+    if (t1 - t0 < cold_ns) cold_ns = t1 - t0;
+    if (t2 - t1 < warm_ns) warm_ns = t2 - t1;
+  }
+
+  printf("%zu ELFs, %zu executable segments, %zu lookups (%zu found)\n", segs.elfs, segs.cnt, lookups, found);
+  printf("  cold: %10.1f us (%.1f ns/lookup)\n", (double)cold_ns / 1000.0, (double)cold_ns / (double)lookups);
+  printf("  warm: %10.1f us (%.1f ns/lookup)\n", (double)warm_ns / 1000.0, (double)warm_ns / (double)lookups);
+  free(addrs);
+  return 0;
+}
@@ -0,0 +1,114 @@
+// xdl_dsym() without XDL_DSYM_INDEX, i.e. the linear .symtab scan with
+// its 16-byte prefilter: random names of the library (hits), the same
+// names with a suffix that no symbol has (misses, a full scan each), and
+// an xdl_sym_query() prefix scan with the head of the first name.
+//
+// usage: xdl_bench_dsym_scan <library> [lookups]
+//
+// A library with a large .symtab (or .gnu_debugdata) and long shared
+// prefixes shows the prefilter best, e.g. libart.so.
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "xdl.h"
+
+#define BENCH_ROUNDS     5
+#define BENCH_NAME_MAX   256
+#define BENCH_MISS_SFX   "_xdl_bench_miss"
+#define BENCH_PREFIX_LEN 8
+
+typedef struct {
+  const char **names;
+  size_t cnt;
+  size_t cap;
+} bench_names_t;
+
+static int bench_collect_cb(xdl_sym_info_t *info, void *arg) {
+  bench_names_t *names = (bench_names_t *)arg;
+  if ('\0' == info->name[0] || strlen(info->name) + sizeof(BENCH_MISS_SFX) > BENCH_NAME_MAX) return 0;
+  if (names->cnt == names->cap) {
+    size_t cap = 0 == names->cap ? 4096 : names->cap * 2;
+    const char **p = realloc(names->names, cap * sizeof(const char *));
+    if (NULL == p) return -1;
+    names->names = p;
+    names->cap = cap;
+  }
+  names->names[names->cnt++] = info->name;
+  return 0;
+}
+
+static int bench_count_cb(xdl_sym_info_t *info, void *arg) {
+  (void)info;
+  (*(size_t *)arg)++;
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <library> [lookups]\n", argv[0]);
+    return 1;
+  }
+  size_t lookups = argc > 2 ? (size_t)strtoul(argv[2], NULL, 10) : 100;
+  if (0 == lookups) lookups = 1;
+
+  if (NULL == dlopen(argv[1], RTLD_NOW)) fprintf(stderr, "cannot dlopen %s\n", argv[1]);
+  void *handle = xdl_open(argv[1], XDL_DEFAULT);
+  if (NULL == handle) {
+    fprintf(stderr, "cannot xdl_open %s\n", argv[1]);
+    return 1;
+  }
+
+  // loads .symtab, so the timings below are scans only
+  bench_names_t names = {NULL, 0, 0};
+  xdl_sym_iterate(handle, XDL_ITERATE_SYMTAB, bench_collect_cb, &names);
+  if (0 == names.cnt) {
+    fprintf(stderr, "no .symtab in %s\n", argv[1]);
+    return 1;
+  }
+
+  char(*hits)[BENCH_NAME_MAX] = malloc(lookups * BENCH_NAME_MAX);
+  char(*misses)[BENCH_NAME_MAX] = malloc(lookups * BENCH_NAME_MAX);
+  if (NULL == hits || NULL == misses) return 1;
+  uint64_t seed = 0x9e3779b97f4a7c15ULL;
+  for (size_t i = 0; i < lookups; i++) {
+    const char *name = names.names[bench_rand(&seed) % names.cnt];
+    snprintf(hits[i], BENCH_NAME_MAX, "%s", name);
+    snprintf(misses[i], BENCH_NAME_MAX, "%s" BENCH_MISS_SFX, name);
+  }
+  char prefix[BENCH_PREFIX_LEN + 1];
+  snprintf(prefix, sizeof(prefix), "%s", names.names[0]);
+
+  uint64_t hit_ns = UINT64_MAX, miss_ns = UINT64_MAX, query_ns = UINT64_MAX;
+  size_t found = 0, queried = 0;
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    uint64_t t0 = bench_now_ns();
+    found = 0;
+    for (size_t i = 0; i < lookups; i++) found += (NULL != xdl_dsym(handle, hits[i], NULL));
+    uint64_t t1 = bench_now_ns();
+    for (size_t i = 0; i < lookups; i++) found += (NULL != xdl_dsym(handle, misses[i], NULL));
+    uint64_t t2 = bench_now_ns();
+    queried = 0;
+    xdl_sym_query(handle, prefix, XDL_ITERATE_SYMTAB | XDL_MATCH_PREFIX, bench_count_cb, &queried);
+    uint64_t t3 = bench_now_ns();
+
+    if (t1 - t0 < hit_ns) hit_ns = t1 - t0;
+    if (t2 - t1 < miss_ns) miss_ns = t2 - t1;
+    if (t3 - t2 < query_ns) query_ns = t3 - t2;
+  }
+
+  printf("%s: %zu .symtab names, %zu lookups (%zu found)\n", argv[1], names.cnt, lookups, found);
+  printf("  hit:   %10.1f us (%.1f us/lookup)\n", (double)hit_ns / 1000.0, (double)hit_ns / 1000.0 / (double)lookups);
+  printf("  miss:  %10.1f us (%.1f us/lookup)\n", (double)miss_ns / 1000.0,
+         (double)miss_ns / 1000.0 / (double)lookups);
+  printf("  query: %10.1f us (\"%s*\", %zu names)\n", (double)query_ns / 1000.0, prefix, queried);
+
+  free(hits);
+  free(misses);
+  free(names.names);
+  xdl_close(handle);
+  return 0;
+}
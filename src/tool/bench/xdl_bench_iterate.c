@@ -0,0 +1,63 @@
+// xdl_iterate_phdr() with XDL_FULL_PATHNAME in a process with many
+// mappings. Only ELFs whose dlpi_name is not an absolute path need
+// /proc/self/maps, so pass libraries by relative path (e.g. ./libfoo.so
+// from their directory) to get more of them.
+//
+// usage: xdl_bench_iterate <mappings> [library...]
+
+#include <dlfcn.h>
+#include <inttypes.h>
+#include <link.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "xdl.h"
+
+#define BENCH_ROUNDS 20
+
+static int bench_count_cb(struct dl_phdr_info *info, size_t size, void *arg) {
+  (void)size;
+  size_t *cnt = (size_t *)arg;
+  cnt[0]++;
+  if (NULL != info->dlpi_name && '/' != info->dlpi_name[0]) cnt[1]++;
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <mappings> [library...]\n", argv[0]);
+    return 1;
+  }
+  size_t mappings = (size_t)strtoul(argv[1], NULL, 10);
+  for (int i = 2; i < argc; i++) {
+    if (NULL == dlopen(argv[i], RTLD_NOW)) fprintf(stderr, "cannot dlopen %s\n", argv[i]);
+  }
+
+  // every other page gets another protection, so the kernel cannot merge them into one mapping
+  size_t page_sz = (size_t)getpagesize();
+  if (mappings > 0) {
+    uint8_t *map = mmap(NULL, mappings * page_sz, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == map) return 1;
+    for (size_t i = 1; i < mappings; i += 2) mprotect(map + i * page_sz, page_sz, PROT_NONE);
+  }
+
+  size_t cnt[2] = {0, 0}, full_cnt[2] = {0, 0};
+  xdl_iterate_phdr(bench_count_cb, cnt, XDL_DEFAULT);
+
+  uint64_t best_ns = UINT64_MAX;
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    full_cnt[0] = full_cnt[1] = 0;
+    uint64_t t0 = bench_now_ns();
+    xdl_iterate_phdr(bench_count_cb, full_cnt, XDL_FULL_PATHNAME);
+    uint64_t t = bench_now_ns() - t0;
+    if (t < best_ns) best_ns = t;
+  }
+
+  printf("%zu ELFs (%zu without an absolute dlpi_name), %zu extra mappings\n", cnt[0], cnt[1], mappings);
+  printf("  XDL_FULL_PATHNAME: %.1f us per iteration, %zu ELFs returned (%zu still relative)\n",
+         (double)best_ns / 1000.0, full_cnt[0], full_cnt[1]);
+  return 0;
+}
@@ -0,0 +1,223 @@
+// xdl_maps_load() and xdl_maps_find() on a large synthetic maps file, against the fgets + sscanf
+// parse xDL used before and a linear search over its result. Every entry and every lookup has to
+// agree with the reference.
+//
+// usage: xdl_bench_maps [lines] [lookups]
+//
+// The file is written to $TMPDIR (/data/local/tmp on Android, /tmp elsewhere) and removed at exit.
+// Lines look like the kernel's: file mappings with long paths, anonymous and named anonymous
+// mappings, [stack]-style names and "(deleted)" files.
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "xdl_maps.h"
+
+#define BENCH_ROUNDS 10
+#define BENCH_PATH_MAX 512
+
+#ifdef __ANDROID__
+#define BENCH_TMPDIR "/data/local/tmp"
+#else
+#define BENCH_TMPDIR "/tmp"
+#endif
+
+typedef struct {
+  uintptr_t start;
+  uintptr_t end;
+  uintptr_t offset;
+  char perms[5];
+  char pathname[BENCH_PATH_MAX];
+} bench_ref_entry_t;
+
+static const char *bench_perms[] = {"r--p", "r-xp", "rw-p", "---p", "rw-s", "r--s"};
+
+static int bench_write_maps(const char *pathname, size_t lines, uintptr_t *last_end) {
+  FILE *fp = fopen(pathname, "w");
+  if (NULL == fp) return -1;
+
+  uint64_t seed = 0x9e3779b97f4a7c15ULL;
+  uintptr_t addr = (uintptr_t)0x10000000;
+  for (size_t i = 0; i < lines; i++) {
+    uint64_t r = bench_rand(&seed);
+    uintptr_t start = addr + (uintptr_t)((r & 3) * 0x1000);  // sometimes a gap before it
+    uintptr_t end = start + (uintptr_t)(((r >> 8) % 64 + 1) * 0x1000);
+    addr = end;
+
+    char name[BENCH_PATH_MAX];
+    switch ((r >> 16) % 6) {
+      case 0:
+        name[0] = '\0';
+        break;
+      case 1:
+        snprintf(name, sizeof(name), "[anon:dalvik-LinearAlloc %zu]", i);
+        break;
+      case 2:
+        snprintf(name, sizeof(name), "%s", 0 == i % 2 ? "[stack]" : "[anon:.bss]");
+        break;
+      case 3:
+        snprintf(name, sizeof(name), "/data/app/~~%016" PRIx64 "==/com.example.app-%zu==/lib/arm64/libapp.so",
+                 r, i % 97);
+        break;
+      case 4:
+        snprintf(name, sizeof(name), "/data/local/tmp/bench %zu.so (deleted)", i % 13);
+        break;
+      default:
+        snprintf(name, sizeof(name), "/apex/com.android.art/lib64/libart_%zu.so", i % 211);
+        break;
+    }
+
+    // the kernel pads the pathname column to a fixed width
+    int len = fprintf(fp, "%08" PRIxPTR "-%08" PRIxPTR " %s %08" PRIxPTR " fd:%02x %" PRIu64, start, end,
+                      bench_perms[(r >> 24) % 6], (uintptr_t)(((r >> 32) % 256) * 0x1000),
+                      (unsigned int)((r >> 40) % 16), '\0' == name[0] ? (uint64_t)0 : (r >> 44));
+    if ('\0' != name[0]) fprintf(fp, "%*s%s", len < 73 ? 73 - len : 1, "", name);
+    fputc('\n', fp);
+  }
+  *last_end = addr;
+  return 0 == fclose(fp) ? 0 : -1;
+}
+
+// the parse xDL did before xdl_maps: stdio, one sscanf per line
+static bench_ref_entry_t *bench_ref_load(const char *pathname, size_t *cnt) {
+  FILE *fp = fopen(pathname, "r");
+  if (NULL == fp) return NULL;
+
+  size_t cap = 1024;
+  bench_ref_entry_t *entries = malloc(cap * sizeof(bench_ref_entry_t));
+  char line[BENCH_PATH_MAX + 128];
+  *cnt = 0;
+  while (NULL != entries && NULL != fgets(line, sizeof(line), fp)) {
+    if (*cnt == cap) {
+      bench_ref_entry_t *p = realloc(entries, (cap *= 2) * sizeof(bench_ref_entry_t));
+      if (NULL == p) {
+        free(entries);
+        entries = NULL;
+        break;
+      }
+      entries = p;
+    }
+    bench_ref_entry_t *e = &entries[*cnt];
+    int pos = 0;
+    if (4 != sscanf(line, "%" SCNxPTR "-%" SCNxPTR " %4s %" SCNxPTR " %*x:%*x %*u%n", &e->start, &e->end,
+                    e->perms, &e->offset, &pos) ||
+        0 == pos)
+      continue;
+    char *name = line + pos;
+    while (' ' == *name) name++;
+    size_t len = strlen(name);
+    while (len > 0 && ('\n' == name[len - 1] || ' ' == name[len - 1])) len--;
+    snprintf(e->pathname, sizeof(e->pathname), "%.*s", (int)len, name);
+    (*cnt)++;
+  }
+  fclose(fp);
+  return entries;
+}
+
+static const bench_ref_entry_t *bench_ref_find(const bench_ref_entry_t *entries, size_t cnt, uintptr_t addr) {
+  for (size_t i = 0; i < cnt; i++)
+    if (addr >= entries[i].start && addr < entries[i].end) return &entries[i];
+  return NULL;
+}
+
+static bool bench_entry_eq(const xdl_maps_entry_t *e, const bench_ref_entry_t *ref) {
+  return e->start == ref->start && e->end == ref->end && e->offset == ref->offset &&
+         e->readable == ('r' == ref->perms[0]) && e->writable == ('w' == ref->perms[1]) &&
+         e->executable == ('x' == ref->perms[2]) && e->is_private == ('p' == ref->perms[3]) &&
+         0 == strcmp(e->pathname, ref->pathname);
+}
+
+int main(int argc, char **argv) {
+  size_t lines = argc > 1 ? (size_t)strtoul(argv[1], NULL, 10) : 20000;
+  size_t lookups = argc > 2 ? (size_t)strtoul(argv[2], NULL, 10) : 100000;
+  if (0 == lines) lines = 1;
+  if (0 == lookups) lookups = 1;
+
+  const char *tmpdir = getenv("TMPDIR");
+  char pathname[BENCH_PATH_MAX];
+  snprintf(pathname, sizeof(pathname), "%s/xdl_bench_maps_%d", NULL == tmpdir ? BENCH_TMPDIR : tmpdir,
+           (int)getpid());
+  uintptr_t last_end;
+  if (0 != bench_write_maps(pathname, lines, &last_end)) {
+    fprintf(stderr, "cannot write %s\n", pathname);
+    return 1;
+  }
+
+  uint64_t load_ns = UINT64_MAX, ref_ns = UINT64_MAX;
+  xdl_maps_t maps;
+  bench_ref_entry_t *ref = NULL;
+  size_t ref_cnt = 0;
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    if (0 != round) {
+      xdl_maps_free(&maps);
+      free(ref);
+    }
+    uint64_t t0 = bench_now_ns();
+    int r = xdl_maps_load(&maps, pathname);
+    uint64_t t1 = bench_now_ns();
+    ref = bench_ref_load(pathname, &ref_cnt);
+    uint64_t t2 = bench_now_ns();
+    if (0 != r || NULL == ref) {
+      fprintf(stderr, "cannot parse %s\n", pathname);
+      unlink(pathname);
+      return 1;
+    }
+    if (t1 - t0 < load_ns) load_ns = t1 - t0;
+    if (t2 - t1 < ref_ns) ref_ns = t2 - t1;
+  }
+  unlink(pathname);
+
+  int failures = 0;
+  if (maps.entries_cnt != ref_cnt) {
+    fprintf(stderr, "MISMATCH: %zu entries, sscanf: %zu\n", maps.entries_cnt, ref_cnt);
+    failures++;
+  }
+  for (size_t i = 0; i < maps.entries_cnt && i < ref_cnt; i++) {
+    if (bench_entry_eq(&maps.entries[i], &ref[i])) continue;
+    fprintf(stderr, "MISMATCH line %zu: \"%s\", sscanf: \"%s\"\n", i + 1, maps.entries[i].pathname,
+            ref[i].pathname);
+    failures++;
+  }
+
+  // inside mappings, in gaps and past both ends
+  uintptr_t *addrs = malloc(lookups * sizeof(uintptr_t));
+  if (NULL == addrs) return 1;
+  uint64_t seed = 0x2545f4914f6cdd1dULL;
+  uintptr_t span = last_end - (uintptr_t)0x10000000 + 0x20000;
+  for (size_t i = 0; i < lookups; i++)
+    addrs[i] = (uintptr_t)0x10000000 - 0x10000 + (uintptr_t)(bench_rand(&seed) % span);
+
+  uint64_t find_ns = UINT64_MAX;
+  size_t found = 0;
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    found = 0;
+    uint64_t t0 = bench_now_ns();
+    for (size_t i = 0; i < lookups; i++) found += (NULL != xdl_maps_find(&maps, addrs[i]));
+    uint64_t t1 = bench_now_ns();
+    if (t1 - t0 < find_ns) find_ns = t1 - t0;
+  }
+  for (size_t i = 0; i < lookups && i < 10000; i++) {
+    const xdl_maps_entry_t *e = xdl_maps_find(&maps, addrs[i]);
+    const bench_ref_entry_t *r = bench_ref_find(ref, ref_cnt, addrs[i]);
+    if ((NULL == e) == (NULL == r) && (NULL == e || bench_entry_eq(e, r))) continue;
+    fprintf(stderr, "MISMATCH xdl_maps_find(%" PRIxPTR ")\n", addrs[i]);
+    failures++;
+  }
+
+  printf("%zu lines, %zu entries, %zu bytes\n", lines, maps.entries_cnt, maps.buf_sz);
+  printf("  xdl_maps_load: %10.1f us\n", (double)load_ns / 1000.0);
+  printf("  fgets+sscanf:  %10.1f us\n", (double)ref_ns / 1000.0);
+  printf("  xdl_maps_find: %10.1f ns/lookup (%zu of %zu mapped)\n", (double)find_ns / (double)lookups, found,
+         lookups);
+  printf("  %d mismatch(es) against sscanf\n", failures);
+
+  free(addrs);
+  free(ref);
+  xdl_maps_free(&maps);
+  return 0 == failures ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+// The .symtab scan of xdl_dsym() in isolation: xdl_dsym_is_match() on every name (scalar) against
+// the same loop behind the xdl_prefix16_* prefilter. The names of a real ELF are copied into one
+// string table in table order; lookups are random names (hits) and the same names with a suffix
+// that no symbol has (misses, a full scan each). Both loops have to find the same entry.
+//
+// usage: xdl_bench_prefix16 <ELF> [lookups]
+//
+// Names come from .symtab, or from .dynsym when there is none. Large C++ tables with long shared
+// prefixes show the prefilter best, e.g. libart.so on a device or node on a host.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "xdl.h"
+#include "xdl_match.h"
+
+#define BENCH_ROUNDS   5
+#define BENCH_NAME_MAX 256
+#define BENCH_MISS_SFX "_xdl_bench_miss"
+
+#if defined(__ARM_NEON)
+#define BENCH_SIMD "NEON"
+#elif defined(__SSE2__)
+#define BENCH_SIMD "SSE2"
+#else
+#define BENCH_SIMD "none"
+#endif
+
+typedef struct {
+  char *strtab;  // the names, NUL separated, followed by 16 bytes of padding
+  size_t strtab_sz;
+  size_t strtab_cap;
+  size_t *offsets;
+  size_t cnt;
+  size_t cap;
+} bench_table_t;
+
+static int bench_collect_cb(xdl_sym_info_t *info, void *arg) {
+  bench_table_t *table = (bench_table_t *)arg;
+  size_t len = strlen(info->name);
+  if (0 == len || len + sizeof(BENCH_MISS_SFX) > BENCH_NAME_MAX) return 0;
+
+  if (table->cnt == table->cap) {
+    size_t cap = 0 == table->cap ? 4096 : table->cap * 2;
+    size_t *p = realloc(table->offsets, cap * sizeof(size_t));
+    if (NULL == p) return -1;
+    table->offsets = p;
+    table->cap = cap;
+  }
+  if (table->strtab_sz + len + 1 + 16 > table->strtab_cap) {
+    size_t cap = 0 == table->strtab_cap ? 65536 : table->strtab_cap * 2;
+    while (table->strtab_sz + len + 1 + 16 > cap) cap *= 2;
+    char *p = realloc(table->strtab, cap);
+    if (NULL == p) return -1;
+    table->strtab = p;
+    table->strtab_cap = cap;
+  }
+  table->offsets[table->cnt++] = table->strtab_sz;
+  memcpy(table->strtab + table->strtab_sz, info->name, len + 1);
+  table->strtab_sz += len + 1;
+  return 0;
+}
+
+static size_t bench_scan_scalar(const bench_table_t *table, const char *symbol) {
+  for (size_t i = 0; i < table->cnt; i++) {
+    size_t off = table->offsets[i];
+    if (xdl_dsym_is_match(table->strtab + off, symbol, table->strtab_sz - off)) return i;
+  }
+  return SIZE_MAX;
+}
+
+// the loop of xdl_dsym() without XDL_DSYM_INDEX
+static size_t bench_scan_prefix16(const bench_table_t *table, const char *symbol) {
+  xdl_prefix16_t prefix;
+  xdl_prefix16_init(&prefix, symbol, strlen(symbol));
+  for (size_t i = 0; i < table->cnt; i++) {
+    size_t off = table->offsets[i];
+    if (prefix.len > 0 && table->strtab_sz >= 16 && off <= table->strtab_sz - 16 &&
+        !xdl_prefix16_may_match(&prefix, table->strtab + off))
+      continue;
+    if (xdl_dsym_is_match(table->strtab + off, symbol, table->strtab_sz - off)) return i;
+  }
+  return SIZE_MAX;
+}
+
+static uint64_t bench_run(const bench_table_t *table, size_t (*scan)(const bench_table_t *, const char *),
+                          const char (*symbols)[BENCH_NAME_MAX], size_t lookups, size_t *results) {
+  uint64_t best = UINT64_MAX;
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    uint64_t t0 = bench_now_ns();
+    for (size_t i = 0; i < lookups; i++) results[i] = scan(table, symbols[i]);
+    uint64_t t1 = bench_now_ns();
+    if (t1 - t0 < best) best = t1 - t0;
+  }
+  return best;
+}
+
+static void bench_print(const char *what, uint64_t scalar_ns, uint64_t prefix16_ns, size_t lookups) {
+  printf("  %s: scalar %8.1f us/lookup, prefix16 %8.1f us/lookup (%.2fx)\n", what,
+         (double)scalar_ns / 1000.0 / (double)lookups, (double)prefix16_ns / 1000.0 / (double)lookups,
+         0 == prefix16_ns ? 0.0 : (double)scalar_ns / (double)prefix16_ns);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <ELF> [lookups]\n", argv[0]);
+    return 1;
+  }
+  size_t lookups = argc > 2 ? (size_t)strtoul(argv[2], NULL, 10) : 100;
+  if (0 == lookups) lookups = 1;
+
+  void *handle = xdl_file_open(argv[1], XDL_DEFAULT);
+  if (NULL == handle) {
+    fprintf(stderr, "cannot xdl_file_open %s\n", argv[1]);
+    return 1;
+  }
+  bench_table_t table;
+  memset(&table, 0, sizeof(table));
+  const char *table_name = ".symtab";
+  xdl_sym_iterate(handle, XDL_ITERATE_SYMTAB, bench_collect_cb, &table);
+  if (0 == table.cnt) {
+    table_name = ".dynsym";
+    xdl_sym_iterate(handle, XDL_ITERATE_DYNSYM, bench_collect_cb, &table);
+  }
+  xdl_close(handle);
+  if (0 == table.cnt) {
+    fprintf(stderr, "no symbols in %s\n", argv[1]);
+    return 1;
+  }
+  memset(table.strtab + table.strtab_sz, 0, 16);
+
+  char(*hits)[BENCH_NAME_MAX] = malloc(lookups * BENCH_NAME_MAX);
+  char(*misses)[BENCH_NAME_MAX] = malloc(lookups * BENCH_NAME_MAX);
+  size_t *scalar_results = malloc(lookups * sizeof(size_t));
+  size_t *prefix16_results = malloc(lookups * sizeof(size_t));
+  if (NULL == hits || NULL == misses || NULL == scalar_results || NULL == prefix16_results) return 1;
+  uint64_t seed = 0x9e3779b97f4a7c15ULL;
+  for (size_t i = 0; i < lookups; i++) {
+    const char *name = table.strtab + table.offsets[bench_rand(&seed) % table.cnt];
+    snprintf(hits[i], BENCH_NAME_MAX, "%s", name);
+    snprintf(misses[i], BENCH_NAME_MAX, "%s" BENCH_MISS_SFX, name);
+  }
+
+  printf("%s: %zu %s names, %zu bytes, %zu lookups, SIMD: %s\n", argv[1], table.cnt, table_name,
+         table.strtab_sz, lookups, BENCH_SIMD);
+
+  int r = 0;
+  const char(*sets[])[BENCH_NAME_MAX] = {hits, misses};
+  const char *set_names[] = {"hit ", "miss"};
+  for (size_t s = 0; s < 2; s++) {
+    uint64_t scalar_ns = bench_run(&table, bench_scan_scalar, sets[s], lookups, scalar_results);
+    uint64_t prefix16_ns = bench_run(&table, bench_scan_prefix16, sets[s], lookups, prefix16_results);
+    bench_print(set_names[s], scalar_ns, prefix16_ns, lookups);
+
+    for (size_t i = 0; i < lookups; i++) {
+      if (scalar_results[i] == prefix16_results[i]) continue;
+      fprintf(stderr, "MISMATCH %s: scalar %zu, prefix16 %zu\n", sets[s][i], scalar_results[i],
+              prefix16_results[i]);
+      r = 1;
+    }
+  }
+
+  free(prefix16_results);
+  free(scalar_results);
+  free(misses);
+  free(hits);
+  free(table.offsets);
+  free(table.strtab);
+  return r;
+}
@@ -12,10 +12,11 @@
 using namespace std;
 using json = nlohmann::json;
 
-const char* short_options = "hcp:d:";
+const char* short_options = "hczp:d:";
 const struct option long_options[] = {
         {"help", no_argument, nullptr, 'h'},
         {"config", no_argument, nullptr, 'c'},
+        {"zero-residue", no_argument, nullptr, 'z'},
         {"package", required_argument, nullptr, 'p'},
         {"delay", required_argument, nullptr, 'd'},
         {nullptr, 0, nullptr, 0}
@@ -26,6 +27,7 @@ void show_usage() {
     printf(" Options:\n");
     printf("  -d, --delay <microseconds>             Delay in microseconds before loading frida-gadget\n");
     printf("  -c, --config                           Activate config mode (default: false)\n");
+    printf("  -z, --zero-residue                     Unload the module from the target after injection (default: false)\n");
     printf("  -h, --help                             Show help\n\n");
 }
 
@@ -47,14 +49,12 @@ void update_json(json& j, const std::vector<std::string>& key_path, const json&
     for (size_t i = 0; i < key_path.size(); ++i) {
         const std::string& key = key_path[i];
 
-        if (current->contains(key)) {
-            if (i == key_path.size() - 1) {
-                // Last key in the path, update the value
-                (*current)[key] = value;
-            } else {
-                // Navigate deeper into the JSON object
-                current = &((*current)[key]);
-            }
+        if (i == key_path.size() - 1 && current->is_object()) {
+            // Last key in the path, update the value (or add it for configs from older versions)
+            (*current)[key] = value;
+        } else if (current->contains(key)) {
+            // Navigate deeper into the JSON object
+            current = &((*current)[key]);
         } else {
             std::cerr << "Key path element '" << key << "' not found in JSON." << std::endl;
             exit(-1);
@@ -124,7 +124,7 @@ int main(int argc, char* argv[]) {
     int option;
     string pkg;
     uint delay = 0;
-    bool isValidArg = true, config_mode = false;
+    bool isValidArg = true, config_mode = false, zero_residue = false;
 
     while((option = getopt_long(argc, argv, short_options, long_options, nullptr)) != -1) {
         switch (option) {
@@ -154,6 +154,9 @@ int main(int argc, char* argv[]) {
                 }
                 break;
             }
+            case 'z':
+                zero_residue = true;
+                break;
             case 'h':
                 show_usage();
                 return -1;
@@ -177,6 +180,8 @@ int main(int argc, char* argv[]) {
     update_json(j, key_path, delay);
     key_path = {"package", "mode", "config"};
     update_json(j, key_path, config_mode);
+    key_path = {"package", "mode", "zero_residue"};
+    update_json(j, key_path, zero_residue);
 
     std::thread t(write_json, j, config_file_path);
     t.detach();
@@ -0,0 +1,495 @@
+// xdl_file_open() handles checked against readelf on a Linux host: every defined .dynsym and
+// .symtab entry that readelf lists has to come back from xdl_sym_iterate(), xdl_sym() and xdl_dsym()
+// with the same value and size. Then copies of each ELF with a corrupted .dynamic, .gnu.hash or
+// .dynsym are opened; the test runs with ASan, so a read outside the file fails it, and no name or
+// value that is not in the original ELF may come back.
+//
+// usage: xdl_test_file <readelf> [ELF...]
+//
+// Without ELF arguments this executable and the libc it runs on are checked.
+
+#include <ctype.h>
+#include <dlfcn.h>
+#include <elf.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <link.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "xdl.h"
+
+#define TEST_CORRUPT_PATHNAME "xdl_test_file_corrupt.so"
+
+typedef struct {
+  char *name;
+  uint64_t value;
+  uint64_t size;
+  int is_symtab;
+  size_t idx;  // order in its table
+} test_sym_t;
+
+typedef struct {
+  test_sym_t *syms;
+  size_t cnt;
+  size_t cap;
+} test_syms_t;
+
+static int test_failures = 0;
+
+#define TEST_FAIL(fmt, ...)                                  \
+  do {                                                       \
+    fprintf(stderr, "FAIL %s: " fmt "\n", elf, __VA_ARGS__); \
+    test_failures++;                                         \
+  } while (0)
+
+static void test_syms_add(test_syms_t *syms, const char *name, uint64_t value, uint64_t size, int is_symtab,
+                          size_t idx) {
+  if (syms->cnt == syms->cap) {
+    syms->cap = 0 == syms->cap ? 1024 : syms->cap * 2;
+    if (NULL == (syms->syms = realloc(syms->syms, syms->cap * sizeof(test_sym_t)))) abort();
+  }
+  test_sym_t *sym = &syms->syms[syms->cnt++];
+  if (NULL == (sym->name = strdup(name))) abort();
+  sym->value = value;
+  sym->size = size;
+  sym->is_symtab = is_symtab;
+  sym->idx = idx;
+}
+
+static void test_syms_free(test_syms_t *syms) {
+  for (size_t i = 0; i < syms->cnt; i++) free(syms->syms[i].name);
+  free(syms->syms);
+  memset(syms, 0, sizeof(*syms));
+}
+
+static int test_sym_cmp(const void *a, const void *b) {
+  const test_sym_t *sa = (const test_sym_t *)a, *sb = (const test_sym_t *)b;
+  if (sa->is_symtab != sb->is_symtab) return sa->is_symtab - sb->is_symtab;
+  int r = strcmp(sa->name, sb->name);
+  if (0 != r) return r;
+  if (sa->value != sb->value) return sa->value < sb->value ? -1 : 1;
+  if (sa->size != sb->size) return sa->size < sb->size ? -1 : 1;
+  return sa->idx < sb->idx ? -1 : (sa->idx > sb->idx ? 1 : 0);
+}
+
+// The entries xDL reports: defined (.symtab: in a real section), named, not a section symbol.
+// readelf appends the version to .dynsym names ("name@VER (2)", "name@@VER"), which is cut off.
+static int test_readelf(const char *readelf, const char *elf, test_syms_t *syms) {
+  char cmd[2048];
+  snprintf(cmd, sizeof(cmd), "'%s' -sW '%s'", readelf, elf);
+  FILE *fp = popen(cmd, "r");
+  if (NULL == fp) return -1;
+
+  char line[4096];
+  int table = -1;  // 0: .dynsym, 1: .symtab, -1: other
+  while (NULL != fgets(line, sizeof(line), fp)) {
+    if (0 == strncmp(line, "Symbol table '", 14)) {
+      table = 0 == strncmp(line + 14, ".dynsym'", 8) ? 0 : (0 == strncmp(line + 14, ".symtab'", 8) ? 1 : -1);
+      continue;
+    }
+    if (table < 0) continue;
+
+    // Num: Value Size Type Bind Vis [other] Ndx Name
+    char *tokens[16], *save = NULL;
+    size_t tokens_cnt = 0;
+    for (char *t = strtok_r(line, " \t\n", &save); NULL != t && tokens_cnt < 16; t = strtok_r(NULL, " \t\n", &save))
+      tokens[tokens_cnt++] = t;
+    if (tokens_cnt < 7 || !isdigit((unsigned char)tokens[0][0])) continue;
+    size_t ndx_i = 6;
+    if ('[' == tokens[6][0]) {
+      while (ndx_i < tokens_cnt && ']' != tokens[ndx_i][strlen(tokens[ndx_i]) - 1]) ndx_i++;
+      ndx_i++;
+    }
+    if (ndx_i >= tokens_cnt) continue;
+
+    const char *ndx = tokens[ndx_i];
+    char *name = ndx_i + 1 < tokens_cnt ? tokens[ndx_i + 1] : "";
+    if (0 == strcmp(ndx, "UND") || 0 == strcmp(tokens[3], "SECTION")) continue;
+    if (1 == table && (0 == strcmp(ndx, "ABS") || 0 == strcmp(ndx, "COM"))) continue;
+    if (0 == table) name[strcspn(name, "@")] = '\0';
+    if ('\0' == name[0]) continue;
+
+    test_syms_add(syms, name, strtoull(tokens[1], NULL, 16), strtoull(tokens[2], NULL, 0), table,
+                  (size_t)strtoul(tokens[0], NULL, 10));
+  }
+  return 0 == pclose(fp) ? 0 : -1;
+}
+
+static int test_collect_cb(xdl_sym_info_t *info, void *arg) {
+  if (STT_SECTION == info->type) return 0;
+  test_syms_t *syms = (test_syms_t *)arg;
+  test_syms_add(syms, info->name, (uint64_t)(uintptr_t)info->addr, info->size, info->is_symtab, syms->cnt);
+  return 0;
+}
+
+// the same multiset of (table, name, value, size); expected is sorted
+static void test_iterate(const char *elf, void *handle, const test_syms_t *expected) {
+  test_syms_t actual = {NULL, 0, 0};
+  xdl_sym_iterate(handle, XDL_ITERATE_DYNSYM | XDL_ITERATE_SYMTAB, test_collect_cb, &actual);
+
+  qsort(actual.syms, actual.cnt, sizeof(test_sym_t), test_sym_cmp);
+  for (size_t i = 0; i < expected->cnt || i < actual.cnt; i++) {
+    test_sym_t *e = i < expected->cnt ? &expected->syms[i] : NULL;
+    test_sym_t *a = i < actual.cnt ? &actual.syms[i] : NULL;
+    if (NULL != e && NULL != a && e->is_symtab == a->is_symtab && 0 == strcmp(e->name, a->name) &&
+        e->value == a->value && e->size == a->size)
+      continue;
+    TEST_FAIL("xdl_sym_iterate: %zu entries, readelf: %zu, first difference: %s (%s) vs %s (%s)", actual.cnt,
+              expected->cnt, NULL == a ? "-" : a->name, NULL == a ? "-" : (a->is_symtab ? ".symtab" : ".dynsym"),
+              NULL == e ? "-" : e->name, NULL == e ? "-" : (e->is_symtab ? ".symtab" : ".dynsym"));
+    break;
+  }
+  printf("  xdl_sym_iterate: %zu entries\n", actual.cnt);
+  test_syms_free(&actual);
+}
+
+// one of the .dynsym entries of the name (versions of a name share it); expected is sorted
+static void test_sym(const char *elf, void *handle, const test_syms_t *expected) {
+  size_t names = 0;
+  for (size_t i = 0; i < expected->cnt && !expected->syms[i].is_symtab;) {
+    size_t end = i + 1;
+    while (end < expected->cnt && !expected->syms[end].is_symtab &&
+           0 == strcmp(expected->syms[i].name, expected->syms[end].name))
+      end++;
+
+    size_t size;
+    uint64_t addr = (uint64_t)(uintptr_t)xdl_sym(handle, expected->syms[i].name, &size);
+    bool found = false;
+    for (size_t j = i; j < end; j++)
+      if (expected->syms[j].value == addr && expected->syms[j].size == size) found = true;
+    if (!found)
+      TEST_FAIL("xdl_sym(%s) = 0x%" PRIx64 " (size %zu), readelf: 0x%" PRIx64 " (size %" PRIu64 ")",
+                expected->syms[i].name, addr, size, expected->syms[i].value, expected->syms[i].size);
+    names++;
+    i = end;
+  }
+  printf("  xdl_sym: %zu names\n", names);
+}
+
+typedef struct {
+  char *key;
+  const test_sym_t *sym;
+} test_key_t;
+
+static int test_key_cmp(const void *a, const void *b) {
+  const test_key_t *ka = (const test_key_t *)a, *kb = (const test_key_t *)b;
+  int r = strcmp(ka->key, kb->key);
+  if (0 != r) return r;
+  return ka->sym->idx < kb->sym->idx ? -1 : (ka->sym->idx > kb->sym->idx ? 1 : 0);
+}
+
+// the first .symtab entry (in table order) named "<name>" or "<name>.<suffix>", as xdl_dsym() defines it;
+// expected is sorted
+static void test_dsym(const char *elf, void *handle, const test_syms_t *expected) {
+  const test_sym_t *symtab = NULL;
+  size_t symtab_cnt = 0;
+  for (size_t i = 0; i < expected->cnt; i++) {
+    if (!expected->syms[i].is_symtab) continue;
+    symtab = &expected->syms[i];
+    symtab_cnt = expected->cnt - i;
+    break;
+  }
+  if (0 == symtab_cnt) {
+    printf("  xdl_dsym: no .symtab\n");
+    return;
+  }
+
+  // every name and every prefix of it that ends before a '.'
+  size_t keys_cnt = 0, keys_cap = symtab_cnt * 2;
+  test_key_t *keys = malloc(keys_cap * sizeof(test_key_t));
+  if (NULL == keys) abort();
+  for (size_t i = 0; i < symtab_cnt; i++) {
+    const char *name = symtab[i].name;
+    size_t len = strlen(name);
+    for (const char *p = name + 1;; p++) {
+      if ('\0' != *p && '.' != *p) continue;
+      if (keys_cnt == keys_cap && NULL == (keys = realloc(keys, (keys_cap *= 2) * sizeof(test_key_t)))) abort();
+      if (NULL == (keys[keys_cnt].key = strndup(name, (size_t)(p - name)))) abort();
+      keys[keys_cnt].sym = &symtab[i];
+      keys_cnt++;
+      if ((size_t)(p - name) == len) break;
+    }
+  }
+  qsort(keys, keys_cnt, sizeof(test_key_t), test_key_cmp);
+
+  size_t names = 0;
+  for (size_t i = 0; i < symtab_cnt; i++) {
+    if (i > 0 && 0 == strcmp(symtab[i].name, symtab[i - 1].name)) continue;
+    const char *name = symtab[i].name;
+
+    size_t lo = 0, hi = keys_cnt;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (strcmp(keys[mid].key, name) < 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    const test_sym_t *first = keys[lo].sym;  // lowest table index of the key
+
+    size_t size;
+    uint64_t addr = (uint64_t)(uintptr_t)xdl_dsym(handle, name, &size);
+    if (addr != first->value || size != first->size)
+      TEST_FAIL("xdl_dsym(%s) = 0x%" PRIx64 " (size %zu), readelf: 0x%" PRIx64 " (size %" PRIu64 ", %s)", name,
+                addr, size, first->value, first->size, first->name);
+    names++;
+  }
+  printf("  xdl_dsym: %zu names\n", names);
+
+  for (size_t i = 0; i < keys_cnt; i++) free(keys[i].key);
+  free(keys);
+}
+
+typedef struct {
+  uint8_t *data;
+  size_t size;
+  ElfW(Shdr) *dynamic;
+  ElfW(Shdr) *gnu_hash;
+  ElfW(Shdr) *dynsym;
+} test_elf_t;
+
+static void test_set_dyn(test_elf_t *e, ElfW(Sxword) tag, ElfW(Sxword) new_tag, ElfW(Xword) val) {
+  ElfW(Dyn) *dyn = (ElfW(Dyn) *)(e->data + e->dynamic->sh_offset);
+  for (size_t i = 0; i < e->dynamic->sh_size / sizeof(ElfW(Dyn)) && DT_NULL != dyn[i].d_tag; i++) {
+    if (tag != dyn[i].d_tag) continue;
+    dyn[i].d_tag = new_tag;
+    dyn[i].d_un.d_val = val;
+  }
+}
+
+static void test_strsz_0(test_elf_t *e) {
+  test_set_dyn(e, DT_STRSZ, DT_STRSZ, 0);
+}
+static void test_strsz_3(test_elf_t *e) {
+  test_set_dyn(e, DT_STRSZ, DT_STRSZ, 3);
+}
+static void test_strsz_huge(test_elf_t *e) {
+  test_set_dyn(e, DT_STRSZ, DT_STRSZ, (ElfW(Xword))-1 >> 8);
+}
+static void test_strsz_none(test_elf_t *e) {
+  ElfW(Dyn) *dyn = (ElfW(Dyn) *)(e->data + e->dynamic->sh_offset);
+  for (size_t i = 0; i < e->dynamic->sh_size / sizeof(ElfW(Dyn)) && DT_NULL != dyn[i].d_tag; i++)
+    if (DT_STRSZ == dyn[i].d_tag) dyn[i].d_tag = 0x6fffffef;  // a tag nobody knows
+}
+static void test_symtab_huge(test_elf_t *e) {
+  test_set_dyn(e, DT_SYMTAB, DT_SYMTAB, (ElfW(Xword))-1 >> 8);
+}
+static void test_bucket_huge(test_elf_t *e) {
+  uint32_t *hdr = (uint32_t *)(e->data + e->gnu_hash->sh_offset);
+  uint32_t *bucket = (uint32_t *)((ElfW(Addr) *)&hdr[4] + hdr[2]);
+  if (hdr[0] > 0) bucket[0] = 0x7fffffff;
+}
+static void test_chain_unterminated(test_elf_t *e) {
+  uint32_t *hdr = (uint32_t *)(e->data + e->gnu_hash->sh_offset);
+  uint32_t *chain = (uint32_t *)((ElfW(Addr) *)&hdr[4] + hdr[2]) + hdr[0];
+  uint32_t *end = (uint32_t *)(e->data + e->gnu_hash->sh_offset + e->gnu_hash->sh_size);
+  for (; chain < end; chain++) *chain &= ~1u;
+}
+static void test_st_name_huge(test_elf_t *e) {
+  ElfW(Sym) *sym = (ElfW(Sym) *)(e->data + e->dynsym->sh_offset);
+  for (size_t i = 1; i < e->dynsym->sh_size / sizeof(ElfW(Sym)); i++) sym[i].st_name = 0xfffffff0;
+}
+
+static const struct {
+  const char *name;
+  void (*corrupt)(test_elf_t *);
+} test_corruptions[] = {
+    {"DT_STRSZ 0", test_strsz_0},
+    {"DT_STRSZ 3", test_strsz_3},
+    {"DT_STRSZ huge", test_strsz_huge},
+    {"no DT_STRSZ", test_strsz_none},
+    {"DT_SYMTAB huge", test_symtab_huge},
+    {"gnu hash bucket huge", test_bucket_huge},
+    {"gnu hash chain unterminated", test_chain_unterminated},
+    {"st_name huge", test_st_name_huge},
+};
+
+static int test_read(const char *pathname, uint8_t **data, size_t *size) {
+  FILE *fp = fopen(pathname, "rb");
+  if (NULL == fp) return -1;
+  fseek(fp, 0, SEEK_END);
+  long len = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  *data = NULL;
+  if (len > 0 && NULL != (*data = malloc((size_t)len)) && 1 == fread(*data, (size_t)len, 1, fp)) {
+    *size = (size_t)len;
+    fclose(fp);
+    return 0;
+  }
+  free(*data);
+  fclose(fp);
+  return -1;
+}
+
+static int test_write(const char *pathname, const uint8_t *data, size_t size) {
+  FILE *fp = fopen(pathname, "wb");
+  if (NULL == fp) return -1;
+  int r = 1 == fwrite(data, size, 1, fp) ? 0 : -1;
+  return 0 == fclose(fp) ? r : -1;
+}
+
+static int test_sym_name_cmp(const void *a, const void *b) {
+  return strcmp(((const test_sym_t *)a)->name, ((const test_sym_t *)b)->name);
+}
+
+static int test_u64_cmp(const void *a, const void *b) {
+  uint64_t ua = *(const uint64_t *)a, ub = *(const uint64_t *)b;
+  return ua < ub ? -1 : (ua > ub ? 1 : 0);
+}
+
+// whatever comes back from a corrupted copy has to be a name and a value of the original
+static void test_corrupt_check(const char *elf, const char *what, void *handle, const test_syms_t *by_name,
+                               const uint64_t *values, size_t values_cnt) {
+  test_syms_t actual = {NULL, 0, 0};
+  xdl_sym_iterate(handle, XDL_ITERATE_DYNSYM | XDL_ITERATE_SYMTAB, test_collect_cb, &actual);
+  for (size_t i = 0; i < actual.cnt; i++) {
+    test_sym_t *a = &actual.syms[i];
+    if (NULL == bsearch(a, by_name->syms, by_name->cnt, sizeof(test_sym_t), test_sym_name_cmp) ||
+        NULL == bsearch(&a->value, values, values_cnt, sizeof(uint64_t), test_u64_cmp)) {
+      TEST_FAIL("%s: xdl_sym_iterate: unknown entry %s = 0x%" PRIx64, what, a->name, a->value);
+      break;
+    }
+  }
+  test_syms_free(&actual);
+
+  for (size_t i = 0; i < by_name->cnt; i++) {
+    if (by_name->syms[i].is_symtab) continue;
+    uint64_t addr = (uint64_t)(uintptr_t)xdl_sym(handle, by_name->syms[i].name, NULL);
+    if (0 != addr && NULL == bsearch(&addr, values, values_cnt, sizeof(uint64_t), test_u64_cmp)) {
+      TEST_FAIL("%s: xdl_sym(%s) = 0x%" PRIx64 ", not a value of the ELF", what, by_name->syms[i].name, addr);
+      break;
+    }
+  }
+}
+
+static void test_corrupt(const char *elf, const test_syms_t *expected) {
+  test_elf_t e;
+  memset(&e, 0, sizeof(e));
+  if (0 != test_read(elf, &e.data, &e.size)) {
+    TEST_FAIL("%s", "cannot read");
+    return;
+  }
+  uint8_t *orig = e.data;
+  ElfW(Ehdr) *ehdr = (ElfW(Ehdr) *)orig;
+  if (e.size < sizeof(ElfW(Ehdr)) || 0 != memcmp(ehdr->e_ident, ELFMAG, SELFMAG) ||
+      ehdr->e_shoff + (size_t)ehdr->e_shnum * sizeof(ElfW(Shdr)) > e.size) {
+    TEST_FAIL("%s", "no section headers");
+    free(orig);
+    return;
+  }
+
+  // the offsets of these are the same in every copy
+  ElfW(Shdr) *shdr = (ElfW(Shdr) *)(orig + ehdr->e_shoff);
+  size_t dynamic_i = 0, gnu_hash_i = 0, dynsym_i = 0;
+  for (size_t i = 0; i < ehdr->e_shnum; i++) {
+    if (SHT_DYNAMIC == shdr[i].sh_type) dynamic_i = i;
+    if (SHT_GNU_HASH == shdr[i].sh_type) gnu_hash_i = i;
+    if (SHT_DYNSYM == shdr[i].sh_type) dynsym_i = i;
+  }
+  if (0 == dynamic_i || 0 == gnu_hash_i || 0 == dynsym_i) {
+    printf("  corrupted copies: no .dynamic, .gnu.hash or .dynsym\n");
+    free(orig);
+    return;
+  }
+
+  test_syms_t by_name = *expected;
+  if (NULL == (by_name.syms = malloc(expected->cnt * sizeof(test_sym_t)))) abort();
+  memcpy(by_name.syms, expected->syms, expected->cnt * sizeof(test_sym_t));
+  qsort(by_name.syms, by_name.cnt, sizeof(test_sym_t), test_sym_name_cmp);
+  uint64_t *values = malloc((expected->cnt + 1) * sizeof(uint64_t));
+  if (NULL == values) abort();
+  for (size_t i = 0; i < expected->cnt; i++) values[i] = expected->syms[i].value;
+  qsort(values, expected->cnt, sizeof(uint64_t), test_u64_cmp);
+
+  if (NULL == (e.data = malloc(e.size))) abort();
+  size_t opened = 0;
+  for (size_t i = 0; i < sizeof(test_corruptions) / sizeof(test_corruptions[0]); i++) {
+    memcpy(e.data, orig, e.size);
+    shdr = (ElfW(Shdr) *)(e.data + ehdr->e_shoff);
+    e.dynamic = &shdr[dynamic_i];
+    e.gnu_hash = &shdr[gnu_hash_i];
+    e.dynsym = &shdr[dynsym_i];
+    test_corruptions[i].corrupt(&e);
+    if (0 != test_write(TEST_CORRUPT_PATHNAME, e.data, e.size)) {
+      TEST_FAIL("cannot write %s", TEST_CORRUPT_PATHNAME);
+      break;
+    }
+
+    void *handle = xdl_file_open(TEST_CORRUPT_PATHNAME, XDL_DEFAULT);
+    if (NULL == handle) continue;
+    opened++;
+    test_corrupt_check(elf, test_corruptions[i].name, handle, &by_name, values, expected->cnt);
+    xdl_close(handle);
+  }
+  unlink(TEST_CORRUPT_PATHNAME);
+  printf("  corrupted copies: %zu, %zu opened\n", sizeof(test_corruptions) / sizeof(test_corruptions[0]), opened);
+
+  free(e.data);
+  free(values);
+  free(by_name.syms);  // the names belong to expected
+  free(orig);
+}
+
+static int test_find_libc_cb(struct dl_phdr_info *info, size_t size, void *arg) {
+  (void)size;
+  const char *basename = strrchr(info->dlpi_name, '/');
+  basename = NULL == basename ? info->dlpi_name : basename + 1;
+  if (0 != strncmp(basename, "libc.so", 7)) return 0;
+  snprintf((char *)arg, PATH_MAX, "%s", info->dlpi_name);
+  return 1;
+}
+
+static void test_elf(const char *readelf, const char *elf) {
+  printf("%s\n", elf);
+  test_syms_t expected = {NULL, 0, 0};
+  if (0 != test_readelf(readelf, elf, &expected)) {
+    TEST_FAIL("cannot run %s", readelf);
+    test_syms_free(&expected);
+    return;
+  }
+  void *handle = xdl_file_open(elf, XDL_DEFAULT);
+  if (NULL == handle) {
+    TEST_FAIL("%s", "xdl_file_open failed");
+    test_syms_free(&expected);
+    return;
+  }
+
+  qsort(expected.syms, expected.cnt, sizeof(test_sym_t), test_sym_cmp);
+  test_iterate(elf, handle, &expected);
+  test_sym(elf, handle, &expected);
+  test_dsym(elf, handle, &expected);
+  xdl_close(handle);
+
+  test_corrupt(elf, &expected);
+  test_syms_free(&expected);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <readelf> [ELF...]\n", argv[0]);
+    return 2;
+  }
+
+  if (argc > 2) {
+    for (int i = 2; i < argc; i++) test_elf(argv[1], argv[i]);
+  } else {
+    char self[PATH_MAX] = "", libc[PATH_MAX] = "";
+    ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (len > 0) self[len] = '\0';
+    dl_iterate_phdr(test_find_libc_cb, libc);
+    if ('\0' == self[0] || '\0' == libc[0]) {
+      fprintf(stderr, "cannot find this executable or libc\n");
+      return 1;
+    }
+    test_elf(argv[1], self);
+    test_elf(argv[1], libc);
+  }
+
+  printf("%d failure(s)\n", test_failures);
+  return 0 == test_failures ? 0 : 1;
+}
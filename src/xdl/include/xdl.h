@@ -35,6 +35,7 @@
 #include <dlfcn.h>
 #include <link.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -62,17 +63,127 @@ typedef struct {
 //
 #define XDL_TRY_FORCE_LOAD    0x01
 #define XDL_ALWAYS_FORCE_LOAD 0x02
+#define XDL_DSYM_INDEX        0x04  // build a hash index of .symtab on the first xdl_dsym()
 void *xdl_open(const char *filename, int flags);
 void *xdl_close(void *handle);
 void *xdl_sym(void *handle, const char *symbol, size_t *symbol_size);
 void *xdl_dsym(void *handle, const char *symbol, size_t *symbol_size);
 
+//
+// xdl_sym() with the GNU and SYSV hashes of the name given by the caller (e.g. computed at compile
+// time, see xdl.hpp). The name does not need to be NUL-terminated.
+//
+void *xdl_sym_hashed(void *handle, const char *symbol, size_t symbol_len, uint32_t gnu_hash, uint32_t sysv_hash,
+                     size_t *symbol_size);
+
+//
+// Open an ELF file on disk without loading it, only flags XDL_DSYM_INDEX is used. The handle works
+// with xdl_sym(), xdl_dsym(), xdl_sym_batch(), xdl_sym_iterate(), xdl_sym_query(), xdl_info() and
+// xdl_close(). Symbol addresses are vaddrs: add dlpi_addr of the loaded ELF to get runtime addresses.
+// The ELF class must match the caller's (e.g. a 64-bit process reads 64-bit files only).
+//
+void *xdl_file_open(const char *pathname, int flags);
+
+//
+// Like dlsym(RTLD_DEFAULT): the first loaded ELF (in link map order) whose .dynsym defines the symbol.
+//
+void *xdl_sym_global(const char *symbol, size_t *symbol_size);
+
+//
+// Resolve many symbols at once: .dynsym by hash, then one pass over .symtab for the rest.
+// Unresolved names get NULL in out_addrs. Returns the number of unresolved names, -1 on error.
+//
+#define XDL_BATCH_DYNSYM 0x01  // same as xdl_sym()
+#define XDL_BATCH_SYMTAB 0x02  // same as xdl_dsym()
+int xdl_sym_batch(void *handle, const char **names, size_t n, void **out_addrs, size_t *out_sizes, int flags);
+
+//
+// Load .dynsym, .symtab (or .gnu_debugdata) and the XDL_DSYM_INDEX index of many handles at once,
+// on a few threads, so that later xdl_sym() / xdl_dsym() calls find them ready.
+// Returns when all are loaded: the number of handles without .symtab, -1 on error.
+//
+int xdl_prewarm(void **handles, size_t n);
+
+//
+// Enumerate the defined symbols of .dynsym and then .symtab, in table order.
+// Names point into the loaded tables and stay valid until xdl_close(). A non-zero return
+// from the callback stops the walk and is returned. Large tables are matched by a few threads,
+// but the callback always runs on the calling thread.
+//
+typedef struct {
+  const char *name;
+  void *addr;
+  size_t size;
+  unsigned char type;  // STT_*
+  unsigned char bind;  // STB_*
+  int is_symtab;       // 0: from .dynsym, 1: from .symtab
+} xdl_sym_info_t;
+typedef int (*xdl_sym_iterate_cb_t)(xdl_sym_info_t *info, void *arg);
+
+#define XDL_ITERATE_DYNSYM  0x01  // (none of these two: both)
+#define XDL_ITERATE_SYMTAB  0x02
+#define XDL_MATCH_GLOB      0x00  // '*' and '?'
+#define XDL_MATCH_PREFIX    0x10
+#define XDL_MATCH_SUBSTRING 0x20
+int xdl_sym_iterate(void *handle, int flags, xdl_sym_iterate_cb_t cb, void *arg);
+int xdl_sym_query(void *handle, const char *pattern, int flags, xdl_sym_iterate_cb_t cb, void *arg);
+
 //
 // Enhanced dladdr().
 //
+// Handles are safe to share between threads, but each thread needs its own cache here.
+//
 int xdl_addr(void *addr, xdl_info_t *info, void **cache);
 void xdl_addr_clean(void **cache);
 
+//
+// xdl_addr() for many addresses (e.g. a backtrace), sharing the cache. Addresses are resolved in
+// address order, so each ELF is visited once. NULL addresses are skipped.
+// Returns the number of addresses found in a loaded ELF, -1 on error.
+//
+int xdl_addr_batch(void **addrs, size_t n, xdl_info_t *infos, void **cache);
+
+//
+// Symbol offset table: xdl_dsym() results for ELF files, computed once by a process that can read
+// them (with xdl_file_open()) and keyed by build-id. Processes that use the table get xdl_dsym() and
+// xdl_sym_batch() answers for loaded ELFs with the same build-id without loading .symtab.
+// Nothing is used until xdl_set_symoff_file() sets a table (NULL: none); the file can be removed after.
+//
+typedef struct {
+  const char *pathname;  // ELF file
+  const char **symbols;
+  size_t symbols_cnt;
+} xdl_symoff_spec_t;
+int xdl_symoff_create(const char *pathname, const xdl_symoff_spec_t *specs, size_t specs_cnt);
+int xdl_set_symoff_file(const char *pathname);
+
+//
+// Symbol cache: the whole .symtab & .strtab of ELF files (also when they come from .gnu_debugdata),
+// extracted once by a process that can read them (with xdl_file_open()) and keyed by build-id.
+// Loaded ELFs with the same build-id then use the tables in place from a read-only mapping of the
+// cache, without opening, mapping or decompressing anything of their own. The cache is only read:
+// nothing is used until xdl_set_symcache_file() sets one (NULL: none), and it stays mapped.
+//
+int xdl_symcache_create(const char *pathname, const char **elfs, size_t elfs_cnt);
+int xdl_set_symcache_file(const char *pathname);
+
+//
+// Allocator for handles and everything they load. It applies to the handles opened by the calling
+// thread after xdl_set_allocator() (NULL: back to malloc), for their whole life, on any thread.
+// An arena makes a lookup session (open many, query, close all) bump allocations on its own
+// mappings, released at once by xdl_arena_destroy() after the handles are closed.
+// The handles that xdl_addr() caches while an arena is set are arena memory too: call xdl_addr_clean()
+// on that cache before xdl_arena_destroy(), it would free them into the destroyed arena afterwards.
+//
+typedef struct {
+  void *(*alloc)(void *ctx, size_t size);  // aligned for any type
+  void (*free)(void *ctx, void *ptr);      // may be NULL
+  void *ctx;
+} xdl_allocator_t;
+void xdl_set_allocator(const xdl_allocator_t *allocator);
+int xdl_arena_create(size_t chunk_size, xdl_allocator_t *allocator);  // chunk_size: 0 for the default
+void xdl_arena_destroy(xdl_allocator_t *allocator);
+
 //
 // Enhanced dl_iterate_phdr().
 //
@@ -0,0 +1,126 @@
+// Copyright (c) 2020-2023 HexHacking Team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+//
+// Header-only C++20 layer over xdl.h: move-only handles and symbol names hashed at compile time.
+// Nothing here allocates.
+//
+
+#ifndef IO_GITHUB_HEXHACKING_XDL_HPP
+#define IO_GITHUB_HEXHACKING_XDL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+#include "xdl.h"
+
+namespace xdl {
+
+// same as xdl_gnu_hash() / xdl_sysv_hash() in xdl.c
+constexpr uint32_t gnu_hash(std::string_view name) {
+  uint32_t h = 5381;
+  for (char c : name) h += (h << 5) + static_cast<uint8_t>(c);
+  return h;
+}
+
+constexpr uint32_t sysv_hash(std::string_view name) {
+  uint32_t h = 0, g;
+  for (char c : name) {
+    h = (h << 4) + static_cast<uint8_t>(c);
+    g = h & 0xf0000000;
+    h ^= g;
+    h ^= g >> 24;
+  }
+  return h;
+}
+
+// A string literal is hashed at compile time; a std::string_view at run time (pass a const char *
+// variable as std::string_view). The characters must outlive the object.
+class symbol_name {
+ public:
+  consteval symbol_name(const char *name)
+      : name_(name), gnu_hash_(xdl::gnu_hash(name)), sysv_hash_(xdl::sysv_hash(name)) {}
+  constexpr symbol_name(std::string_view name)
+      : name_(name), gnu_hash_(xdl::gnu_hash(name)), sysv_hash_(xdl::sysv_hash(name)) {}
+
+  constexpr std::string_view name() const { return name_; }
+  constexpr uint32_t gnu_hash() const { return gnu_hash_; }
+  constexpr uint32_t sysv_hash() const { return sysv_hash_; }
+
+ private:
+  std::string_view name_;
+  uint32_t gnu_hash_;
+  uint32_t sysv_hash_;
+};
+
+class handle {
+ public:
+  constexpr handle() = default;
+  explicit handle(void *h) : h_(h) {}
+  handle(handle &&other) noexcept : h_(std::exchange(other.h_, nullptr)) {}
+  handle &operator=(handle &&other) noexcept {
+    if (this != &other) {
+      close();
+      h_ = std::exchange(other.h_, nullptr);
+    }
+    return *this;
+  }
+  handle(const handle &) = delete;
+  handle &operator=(const handle &) = delete;
+  // drops what xdl_close() returns, so an ELF loaded by XDL_TRY_FORCE_LOAD stays loaded
+  // (call close() to get the linker's handle for dlclose())
+  ~handle() { close(); }
+
+  static handle open(const char *filename, int flags = XDL_DEFAULT) { return handle(xdl_open(filename, flags)); }
+  static handle file_open(const char *pathname, int flags = XDL_DEFAULT) {
+    return handle(xdl_file_open(pathname, flags));
+  }
+
+  explicit operator bool() const { return nullptr != h_; }
+  void *get() const { return h_; }
+  void *release() { return std::exchange(h_, nullptr); }
+
+  // returns what xdl_close() returns (the linker's handle for force-loaded ELFs)
+  void *close() { return nullptr != h_ ? xdl_close(std::exchange(h_, nullptr)) : nullptr; }
+
+  template <typename T = void *>
+  T sym(const symbol_name &symbol, size_t *symbol_size = nullptr) const {
+    return reinterpret_cast<T>(xdl_sym_hashed(h_, symbol.name().data(), symbol.name().size(), symbol.gnu_hash(),
+                                              symbol.sysv_hash(), symbol_size));
+  }
+
+  // .symtab lookups need a NUL-terminated name
+  template <typename T = void *>
+  T dsym(const char *symbol, size_t *symbol_size = nullptr) const {
+    return reinterpret_cast<T>(xdl_dsym(h_, symbol, symbol_size));
+  }
+
+  bool info(xdl_info_t *info) const { return 0 == xdl_info(h_, XDL_DI_DLINFO, info); }
+
+ private:
+  void *h_ = nullptr;
+};
+
+}  // namespace xdl
+
+#endif
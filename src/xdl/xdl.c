@@ -23,12 +23,13 @@
 
 #include "xdl.h"
 
-#include <android/api-level.h>
 #include <elf.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <link.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -41,15 +42,22 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "xdl_arena.h"
 #include "xdl_iterate.h"
 #include "xdl_linker.h"
 #include "xdl_lzma.h"
+#include "xdl_match.h"
+#include "xdl_registry.h"
+#include "xdl_symcache.h"
+#include "xdl_symoff.h"
 #include "xdl_util.h"
 
 #ifndef __LP64__
-#define XDL_LIB_PATH "/system/lib"
+#define XDL_LIB_PATH  "/system/lib"
+#define XDL_ELF_CLASS ELFCLASS32
 #else
-#define XDL_LIB_PATH "/system/lib64"
+#define XDL_LIB_PATH  "/system/lib64"
+#define XDL_ELF_CLASS ELFCLASS64
 #endif
 
 #define XDL_DYNSYM_IS_EXPORT_SYM(shndx) (SHN_UNDEF != (shndx))
@@ -61,7 +69,21 @@ extern __attribute((weak)) unsigned long int getauxval(unsigned long int);
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wpadded"
 
+// Address-sorted view of a symbol table, for reverse lookups in xdl_addr().
+typedef struct {
+  uintptr_t start;  // st_value
+  uintptr_t reach;  // max(st_value + st_size) of this and all preceding entries
+  size_t idx;       // index into .dynsym / .symtab
+} xdl_addr_entry_t;
+
+typedef struct {
+  atomic_bool try_build;
+  xdl_addr_entry_t *entries;
+  size_t cnt;
+} xdl_addr_index_t;
+
 typedef struct xdl {
+  xdl_allocator_t allocator;  // of the thread that opened it, used for everything below
   char *pathname;
   uintptr_t load_bias;
   const ElfW(Phdr) *dlpi_phdr;
@@ -74,9 +96,10 @@ typedef struct xdl {
   // (1) for searching symbols from .dynsym
   //
 
-  bool dynsym_try_load;
+  atomic_bool dynsym_try_load;
   ElfW(Sym) *dynsym;   // .dynsym
   const char *dynstr;  // .dynstr
+  size_t dynstr_sz;    // DT_STRSZ, SIZE_MAX if a loaded ELF has none
 
   // .hash (SYSV hash for .dynstr)
   struct {
@@ -101,61 +124,267 @@ typedef struct xdl {
   // (2) for searching symbols from .symtab
   //
 
-  bool symtab_try_load;
+  atomic_bool symtab_try_load;
   uintptr_t base;
 
   ElfW(Sym) *symtab;  // .symtab
   size_t symtab_cnt;
   char *strtab;  // .strtab
   size_t strtab_sz;
+
+  // read-only mapping that .symtab & .strtab point into (NULL when on the heap)
+  void *symtab_map;
+  size_t symtab_map_sz;
+  bool symtab_cached;  // .symtab & .strtab point into the symbol cache, which stays mapped
+
+  // GNU build-id that keys the symbol offset table (found on first use)
+  atomic_bool build_id_try_load;
+  const uint8_t *build_id;
+  size_t build_id_sz;
+
+  // hash index of canonical names in .symtab (only with XDL_DSYM_INDEX, built on first use)
+  bool dsym_index_enabled;
+  struct {
+    atomic_bool try_build;
+    uint32_t *buckets;  // first symtab index + 1 of each bucket, 0 for empty
+    uint32_t buckets_cnt;
+    uint32_t *chains;  // next symtab index + 1 in the same bucket, 0 ends the chain
+    uint32_t *hashes;  // canonical name hash of each symtab entry
+  } dsym_index;
+
+  //
+  // (3) for searching symbols by address (built on first use)
+  //
+
+  xdl_addr_index_t dynsym_addr_index;
+  xdl_addr_index_t symtab_addr_index;
+
+  // serializes the lazy loading above; lookups never take it once a table is ready
+  pthread_mutex_t lock;
+
+  // whole-file mapping of xdl_file_open() (NULL for loaded ELFs), vaddrs are translated by PT_LOAD
+  void *file_map;
+  size_t file_sz;
 } xdl_t;
 
+// the cache used by xdl_addr()
+typedef struct {
+  uintptr_t start;
+  uintptr_t end;
+  xdl_t *handle;
+} xdl_addr_range_t;
+
+typedef struct {
+  xdl_addr_range_t *ranges;  // one for each PT_LOAD segment, sorted by start
+  size_t ranges_cnt;
+  size_t ranges_cap;
+  size_t last;     // index of the last hit
+  xdl_t *handles;  // all cached handles, linked by next
+} xdl_addr_cache_t;
+
 #pragma clang diagnostic pop
 
-// load from memory
+// allocator of the handles opened by this thread (zero: malloc)
+static __thread xdl_allocator_t xdl_thread_allocator;
+
+static void *xdl_alloc(const xdl_allocator_t *allocator, size_t size) {
+  return NULL != allocator->alloc ? allocator->alloc(allocator->ctx, size) : malloc(size);
+}
+
+static void *xdl_calloc(const xdl_allocator_t *allocator, size_t cnt, size_t size) {
+  if (0 != size && cnt > SIZE_MAX / size) return NULL;
+  void *ptr = xdl_alloc(allocator, cnt * size);
+  if (NULL != ptr) memset(ptr, 0, cnt * size);
+  return ptr;
+}
+
+static void xdl_free(const xdl_allocator_t *allocator, void *ptr) {
+  if (NULL == ptr) return;
+  if (NULL == allocator->alloc)
+    free(ptr);
+  else if (NULL != allocator->free)
+    allocator->free(allocator->ctx, ptr);
+}
+
+// allocator: NULL for malloc()
+static xdl_t *xdl_handle_create(const char *pathname, const xdl_allocator_t *allocator) {
+  xdl_allocator_t a;
+  if (NULL != allocator)
+    a = *allocator;
+  else
+    memset(&a, 0, sizeof(a));
+
+  xdl_t *self = (xdl_t *)xdl_calloc(&a, 1, sizeof(xdl_t));
+  if (NULL == self) return NULL;
+  size_t pathname_len = strlen(pathname);
+  if (NULL == (self->pathname = (char *)xdl_alloc(&a, pathname_len + 1))) {
+    xdl_free(&a, self);
+    return NULL;
+  }
+  memcpy(self->pathname, pathname, pathname_len + 1);
+  self->allocator = a;
+  self->dynsym_try_load = false;
+  self->symtab_try_load = false;
+  self->build_id_try_load = false;
+  pthread_mutex_init(&self->lock, NULL);
+  return self;
+}
+
+// run init() at most once for each flag, after that the read path is a single acquire load
+static void xdl_once(xdl_t *self, atomic_bool *done, void (*init)(xdl_t *)) {
+  if (atomic_load_explicit(done, memory_order_acquire)) return;
+
+  pthread_mutex_lock(&self->lock);
+  if (!atomic_load_explicit(done, memory_order_relaxed)) {
+    init(self);
+    atomic_store_explicit(done, true, memory_order_release);
+  }
+  pthread_mutex_unlock(&self->lock);
+}
+
+static void *xdl_get_memory(void *mem, size_t mem_sz, size_t data_offset, size_t data_len) {
+  if (0 == data_len) return NULL;
+  if (data_offset >= mem_sz) return NULL;
+  if (data_offset + data_len > mem_sz) return NULL;
+
+  return (void *)((uintptr_t)mem + data_offset);
+}
+
+static void *xdl_get_memory_by_section(void *mem, size_t mem_sz, ElfW(Shdr) *shdr) {
+  return xdl_get_memory(mem, mem_sz, (size_t)shdr->sh_offset, shdr->sh_size);
+}
+
+// memory of [vaddr, vaddr + len): in the process for loaded ELFs, in the mapping for xdl_file_open()
+static void *xdl_vaddr_to_mem(xdl_t *self, ElfW(Addr) vaddr, size_t len) {
+  if (NULL == self->file_map) return (void *)(self->load_bias + vaddr);
+
+  for (size_t i = 0; i < self->dlpi_phnum; i++) {
+    const ElfW(Phdr) *phdr = &(self->dlpi_phdr[i]);
+    if (PT_LOAD != phdr->p_type || vaddr < phdr->p_vaddr || vaddr - phdr->p_vaddr >= phdr->p_filesz) continue;
+    if (len > phdr->p_filesz - (vaddr - phdr->p_vaddr)) return NULL;
+    return xdl_get_memory(self->file_map, self->file_sz, (size_t)(phdr->p_offset + (vaddr - phdr->p_vaddr)),
+                          len);
+  }
+  return NULL;
+}
+
+// a file is not checked by the linker, so every .dynsym / .dynstr / hash table access of a file handle
+// must stay in the mapping: count the symbols from the hash tables, and bound .dynsym and .dynstr by them
+static int xdl_dynsym_check_file(xdl_t *self, ElfW(Addr) dynsym_vaddr, ElfW(Addr) dynstr_vaddr,
+                                 ElfW(Addr) gnu_chains_vaddr) {
+  // .dynstr ends with NUL, so no name read runs past it
+  if (0 == self->dynstr_sz || SIZE_MAX == self->dynstr_sz) return -1;
+  if (NULL == xdl_vaddr_to_mem(self, dynstr_vaddr, self->dynstr_sz)) return -1;
+  if ('\0' != self->dynstr[self->dynstr_sz - 1]) return -1;
+
+  size_t sym_cnt = 0;
+  if (self->sysv_hash.buckets_cnt > 0) {
+    // nchain is the number of symbols, and every link must point into it
+    sym_cnt = self->sysv_hash.chains_cnt;
+    for (size_t i = 0; i < self->sysv_hash.buckets_cnt; i++)
+      if (self->sysv_hash.buckets[i] >= sym_cnt) return -1;
+    for (size_t i = 0; i < self->sysv_hash.chains_cnt; i++)
+      if (self->sysv_hash.chains[i] >= sym_cnt) return -1;
+  }
+  if (self->gnu_hash.buckets_cnt > 0) {
+    if (0 == self->gnu_hash.bloom_cnt) return -1;
+
+    // the chain of the last non-empty bucket ends the table, check each word before reading it
+    uint32_t last = 0;
+    for (size_t i = 0; i < self->gnu_hash.buckets_cnt; i++)
+      if (last < self->gnu_hash.buckets[i]) last = self->gnu_hash.buckets[i];
+    if (last >= self->gnu_hash.symoffset) {
+      while (1) {
+        ElfW(Addr) vaddr = gnu_chains_vaddr + (ElfW(Addr))(last - self->gnu_hash.symoffset) * 4;
+        const uint32_t *chain = (const uint32_t *)xdl_vaddr_to_mem(self, vaddr, 4);
+        if (NULL == chain) return -1;
+        if (*chain & 1) break;
+        if (UINT32_MAX == last++) return -1;
+      }
+      last++;
+    }
+    if (sym_cnt < last) sym_cnt = last;
+    if (sym_cnt < self->gnu_hash.symoffset) sym_cnt = self->gnu_hash.symoffset;
+  }
+
+  // .dynsym holds every symbol the hash tables can reach
+  if (sym_cnt > SIZE_MAX / sizeof(ElfW(Sym))) return -1;
+  if (NULL == xdl_vaddr_to_mem(self, dynsym_vaddr, sym_cnt * sizeof(ElfW(Sym)))) return -1;
+  return 0;
+}
+
+// load from memory (or from the file mapping)
 static int xdl_dynsym_load(xdl_t *self) {
   // find the dynamic segment
   ElfW(Dyn) *dynamic = NULL;
+  size_t dynamic_cnt = SIZE_MAX;
   for (size_t i = 0; i < self->dlpi_phnum; i++) {
     const ElfW(Phdr) *phdr = &(self->dlpi_phdr[i]);
     if (PT_DYNAMIC == phdr->p_type) {
-      dynamic = (ElfW(Dyn) *)(self->load_bias + phdr->p_vaddr);
+      dynamic = (ElfW(Dyn) *)xdl_vaddr_to_mem(self, phdr->p_vaddr, phdr->p_filesz);
+      if (NULL != self->file_map) dynamic_cnt = phdr->p_filesz / sizeof(ElfW(Dyn));
       break;
     }
   }
   if (NULL == dynamic) return -1;
 
   // iterate the dynamic segment
-  for (ElfW(Dyn) *entry = dynamic; entry && entry->d_tag != DT_NULL; entry++) {
+  ElfW(Addr) dynsym_vaddr = 0, dynstr_vaddr = 0, gnu_chains_vaddr = 0;
+  size_t dynstr_sz = 0;
+  for (ElfW(Dyn) *entry = dynamic; (size_t)(entry - dynamic) < dynamic_cnt && entry->d_tag != DT_NULL;
+       entry++) {
+    ElfW(Addr) d_ptr = NULL == self->file_map ? XDL_UTIL_DYN_PTR_TO_VADDR(entry->d_un.d_ptr, self->load_bias)
+                                              : entry->d_un.d_ptr;
     switch (entry->d_tag) {
       case DT_SYMTAB:  //.dynsym
-        self->dynsym = (ElfW(Sym) *)(self->load_bias + entry->d_un.d_ptr);
+        self->dynsym = (ElfW(Sym) *)xdl_vaddr_to_mem(self, d_ptr, sizeof(ElfW(Sym)));
+        dynsym_vaddr = d_ptr;
         break;
       case DT_STRTAB:  //.dynstr
-        self->dynstr = (const char *)(self->load_bias + entry->d_un.d_ptr);
+        self->dynstr = (const char *)xdl_vaddr_to_mem(self, d_ptr, 1);
+        dynstr_vaddr = d_ptr;
+        break;
+      case DT_STRSZ:
+        dynstr_sz = (size_t)entry->d_un.d_val;
         break;
-      case DT_HASH:  //.hash
-        self->sysv_hash.buckets_cnt = ((const uint32_t *)(self->load_bias + entry->d_un.d_ptr))[0];
-        self->sysv_hash.chains_cnt = ((const uint32_t *)(self->load_bias + entry->d_un.d_ptr))[1];
-        self->sysv_hash.buckets = &(((const uint32_t *)(self->load_bias + entry->d_un.d_ptr))[2]);
+      case DT_HASH: {  //.hash
+        const uint32_t *hash = (const uint32_t *)xdl_vaddr_to_mem(self, d_ptr, 8);
+        if (NULL == hash) break;
+        if (NULL == xdl_vaddr_to_mem(self, d_ptr, 8 + ((size_t)hash[0] + hash[1]) * 4)) break;
+        self->sysv_hash.buckets_cnt = hash[0];
+        self->sysv_hash.chains_cnt = hash[1];
+        self->sysv_hash.buckets = &(hash[2]);
         self->sysv_hash.chains = &(self->sysv_hash.buckets[self->sysv_hash.buckets_cnt]);
         break;
-      case DT_GNU_HASH:  //.gnu.hash
-        self->gnu_hash.buckets_cnt = ((const uint32_t *)(self->load_bias + entry->d_un.d_ptr))[0];
-        self->gnu_hash.symoffset = ((const uint32_t *)(self->load_bias + entry->d_un.d_ptr))[1];
-        self->gnu_hash.bloom_cnt = ((const uint32_t *)(self->load_bias + entry->d_un.d_ptr))[2];
-        self->gnu_hash.bloom_shift = ((const uint32_t *)(self->load_bias + entry->d_un.d_ptr))[3];
-        self->gnu_hash.bloom = (const ElfW(Addr) *)(self->load_bias + entry->d_un.d_ptr + 16);
+      }
+      case DT_GNU_HASH: {  //.gnu.hash
+        const uint32_t *hash = (const uint32_t *)xdl_vaddr_to_mem(self, d_ptr, 16);
+        if (NULL == hash) break;
+        if (NULL == xdl_vaddr_to_mem(self, d_ptr,
+                                     16 + (size_t)hash[2] * sizeof(ElfW(Addr)) + (size_t)hash[0] * 4))
+          break;
+        self->gnu_hash.buckets_cnt = hash[0];
+        self->gnu_hash.symoffset = hash[1];
+        self->gnu_hash.bloom_cnt = hash[2];
+        self->gnu_hash.bloom_shift = hash[3];
+        self->gnu_hash.bloom = (const ElfW(Addr) *)(&(hash[4]));
         self->gnu_hash.buckets = (const uint32_t *)(&(self->gnu_hash.bloom[self->gnu_hash.bloom_cnt]));
         self->gnu_hash.chains = (const uint32_t *)(&(self->gnu_hash.buckets[self->gnu_hash.buckets_cnt]));
+        gnu_chains_vaddr =
+            d_ptr + 16 + (ElfW(Addr))hash[2] * sizeof(ElfW(Addr)) + (ElfW(Addr))hash[0] * 4;
         break;
+      }
       default:
         break;
     }
   }
 
+  self->dynstr_sz = (0 == dynstr_sz && NULL == self->file_map ? SIZE_MAX : dynstr_sz);
+
   if (NULL == self->dynsym || NULL == self->dynstr ||
-      (0 == self->sysv_hash.buckets_cnt && 0 == self->gnu_hash.buckets_cnt)) {
+      (0 == self->sysv_hash.buckets_cnt && 0 == self->gnu_hash.buckets_cnt) ||
+      (NULL != self->file_map &&
+       0 != xdl_dynsym_check_file(self, dynsym_vaddr, dynstr_vaddr, gnu_chains_vaddr))) {
     self->dynsym = NULL;
     self->dynstr = NULL;
     self->sysv_hash.buckets_cnt = 0;
@@ -166,14 +395,15 @@ static int xdl_dynsym_load(xdl_t *self) {
   return 0;
 }
 
-static void *xdl_read_file_to_heap(int file_fd, size_t file_sz, size_t data_offset, size_t data_len) {
+static void *xdl_read_file_to_heap(const xdl_allocator_t *allocator, int file_fd, size_t file_sz,
+                                   size_t data_offset, size_t data_len) {
   if (0 == data_len) return NULL;
   if (data_offset >= file_sz) return NULL;
   if (data_offset + data_len > file_sz) return NULL;
 
   if (data_offset != (size_t)lseek(file_fd, (off_t)data_offset, SEEK_SET)) return NULL;
 
-  void *data = malloc(data_len);
+  void *data = xdl_alloc(allocator, data_len);
   if (NULL == data) return NULL;
 
 #pragma clang diagnostic push
@@ -181,109 +411,289 @@ static void *xdl_read_file_to_heap(int file_fd, size_t file_sz, size_t data_offs
   if ((ssize_t)data_len != XDL_UTIL_TEMP_FAILURE_RETRY(read(file_fd, data, data_len)))
 #pragma clang diagnostic pop
   {
-    free(data);
+    xdl_free(allocator, data);
     return NULL;
   }
 
   return data;
 }
 
-static void *xdl_read_file_to_heap_by_section(int file_fd, size_t file_sz, ElfW(Shdr) *shdr) {
-  return xdl_read_file_to_heap(file_fd, file_sz, (size_t)shdr->sh_offset, shdr->sh_size);
+static void *xdl_read_file_to_heap_by_section(const xdl_allocator_t *allocator, int file_fd, size_t file_sz,
+                                              ElfW(Shdr) *shdr) {
+  return xdl_read_file_to_heap(allocator, file_fd, file_sz, (size_t)shdr->sh_offset, shdr->sh_size);
 }
 
-static void *xdl_read_memory_to_heap(void *mem, size_t mem_sz, size_t data_offset, size_t data_len) {
+static void *xdl_read_memory_to_heap(const xdl_allocator_t *allocator, void *mem, size_t mem_sz,
+                                     size_t data_offset, size_t data_len) {
   if (0 == data_len) return NULL;
   if (data_offset >= mem_sz) return NULL;
   if (data_offset + data_len > mem_sz) return NULL;
 
-  void *data = malloc(data_len);
+  void *data = xdl_alloc(allocator, data_len);
   if (NULL == data) return NULL;
 
   memcpy(data, (void *)((uintptr_t)mem + data_offset), data_len);
   return data;
 }
 
-static void *xdl_read_memory_to_heap_by_section(void *mem, size_t mem_sz, ElfW(Shdr) *shdr) {
-  return xdl_read_memory_to_heap(mem, mem_sz, (size_t)shdr->sh_offset, shdr->sh_size);
+static void *xdl_read_memory_to_heap_by_section(const xdl_allocator_t *allocator, void *mem, size_t mem_sz,
+                                                ElfW(Shdr) *shdr) {
+  return xdl_read_memory_to_heap(allocator, mem, mem_sz, (size_t)shdr->sh_offset, shdr->sh_size);
 }
 
-static void *xdl_get_memory(void *mem, size_t mem_sz, size_t data_offset, size_t data_len) {
-  if (0 == data_len) return NULL;
-  if (data_offset >= mem_sz) return NULL;
-  if (data_offset + data_len > mem_sz) return NULL;
+// find the NT_GNU_BUILD_ID note in the loaded segments
+static const uint8_t *xdl_get_build_id(xdl_t *self, size_t *build_id_sz) {
+  for (size_t i = 0; i < self->dlpi_phnum; i++) {
+    const ElfW(Phdr) *phdr = &(self->dlpi_phdr[i]);
+    if (PT_NOTE != phdr->p_type) continue;
+
+    uintptr_t cur = (uintptr_t)xdl_vaddr_to_mem(self, phdr->p_vaddr, phdr->p_filesz);
+    if (0 == cur) continue;
+    uintptr_t end = cur + phdr->p_filesz;
+    while (cur + sizeof(ElfW(Nhdr)) <= end) {
+      ElfW(Nhdr) *nhdr = (ElfW(Nhdr) *)cur;
+      uintptr_t name = cur + sizeof(ElfW(Nhdr));
+      uintptr_t desc = name + ((nhdr->n_namesz + 3) & ~(uintptr_t)3);
+      uintptr_t next = desc + ((nhdr->n_descsz + 3) & ~(uintptr_t)3);
+      if (next > end || next <= cur) break;
+
+      if (NT_GNU_BUILD_ID == nhdr->n_type && 4 == nhdr->n_namesz && 0 == memcmp((void *)name, "GNU", 4)) {
+        *build_id_sz = nhdr->n_descsz;
+        return (const uint8_t *)desc;
+      }
+      cur = next;
+    }
+  }
+  return NULL;
+}
 
-  return (void *)((uintptr_t)mem + data_offset);
+static void xdl_build_id_init(xdl_t *self) {
+  self->build_id = xdl_get_build_id(self, &self->build_id_sz);
 }
 
-static void *xdl_get_memory_by_section(void *mem, size_t mem_sz, ElfW(Shdr) *shdr) {
-  return xdl_get_memory(mem, mem_sz, (size_t)shdr->sh_offset, shdr->sh_size);
+// find .symtab & .strtab in an ELF image in memory
+static int xdl_elf_find_symtab(void *elf, size_t elf_sz, ElfW(Shdr) **shdr_symtab, ElfW(Shdr) **shdr_strtab) {
+  // get ELF header
+  if (elf_sz < sizeof(ElfW(Ehdr))) return -1;
+  ElfW(Ehdr) *ehdr = (ElfW(Ehdr) *)elf;
+  if (0 == ehdr->e_shnum || ehdr->e_shentsize != sizeof(ElfW(Shdr))) return -1;
+  if (0 != ehdr->e_shoff % sizeof(ElfW(Addr))) return -1;
+
+  // get section headers
+  ElfW(Shdr) *shdrs =
+      (ElfW(Shdr) *)xdl_get_memory(elf, elf_sz, (size_t)ehdr->e_shoff, ehdr->e_shentsize * ehdr->e_shnum);
+  if (NULL == shdrs) return -1;
+
+  // get .shstrtab
+  if (SHN_UNDEF == ehdr->e_shstrndx || ehdr->e_shstrndx >= ehdr->e_shnum) return -1;
+  ElfW(Shdr) *shdr_shstrtab = shdrs + ehdr->e_shstrndx;
+  char *shstrtab = (char *)xdl_get_memory_by_section(elf, elf_sz, shdr_shstrtab);
+  if (NULL == shstrtab) return -1;
+
+  // find .symtab & .strtab
+  for (ElfW(Shdr) *shdr = shdrs; shdr < shdrs + ehdr->e_shnum; shdr++) {
+    if (shdr->sh_name >= shdr_shstrtab->sh_size) continue;
+    char *shdr_name = shstrtab + shdr->sh_name;
+
+    if (SHT_SYMTAB == shdr->sh_type && 0 == strcmp(".symtab", shdr_name)) {
+      if (sizeof(ElfW(Sym)) != shdr->sh_entsize) continue;
+
+      // get & check associated .strtab section
+      if (shdr->sh_link >= ehdr->e_shnum) continue;
+      ElfW(Shdr) *shdr_link = shdrs + shdr->sh_link;
+      if (SHT_STRTAB != shdr_link->sh_type) continue;
+
+      // check .symtab & .strtab
+      if (NULL == xdl_get_memory_by_section(elf, elf_sz, shdr)) continue;
+      if (NULL == xdl_get_memory_by_section(elf, elf_sz, shdr_link)) continue;
+
+      // OK
+      *shdr_symtab = shdr;
+      *shdr_strtab = shdr_link;
+      return 0;
+    }
+  }
+
+  return -1;
 }
 
-// load from disk and memory
-static int xdl_symtab_load_from_debugdata(xdl_t *self, int file_fd, size_t file_sz,
-                                          ElfW(Shdr) *shdr_debugdata) {
-  void *debugdata = NULL;
-  ElfW(Shdr) *shdrs = NULL;
-  int r = -1;
+// decompress into an exact-sized anonymous mapping, then only keep the pages of .symtab & .strtab
+static int xdl_symtab_load_from_debugdata_to_map(xdl_t *self, uint8_t *debugdata_zip, size_t debugdata_zip_sz) {
+  size_t debugdata_sz;
+  if (0 != xdl_lzma_get_uncompressed_size(debugdata_zip, debugdata_zip_sz, &debugdata_sz)) return -1;
+
+  size_t page_sz = (size_t)getpagesize();
+  size_t map_sz = (debugdata_sz + page_sz - 1) & ~(page_sz - 1);
+  uint8_t *map = (uint8_t *)mmap(NULL, map_sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == map) return -1;
+
+  ElfW(Shdr) *shdr_symtab, *shdr_strtab;
+  if (0 != xdl_lzma_decompress_to(debugdata_zip, debugdata_zip_sz, map, debugdata_sz)) goto err;
+  if (0 != xdl_elf_find_symtab(map, debugdata_sz, &shdr_symtab, &shdr_strtab)) goto err;
+
+  // the section headers are in the pages released below
+  size_t symtab_offset = (size_t)shdr_symtab->sh_offset, symtab_sz = shdr_symtab->sh_size;
+  size_t strtab_offset = (size_t)shdr_strtab->sh_offset, strtab_sz = shdr_strtab->sh_size;
+  size_t keep_start = (symtab_offset < strtab_offset ? symtab_offset : strtab_offset) & ~(page_sz - 1);
+  size_t keep_end = symtab_offset + symtab_sz > strtab_offset + strtab_sz ? symtab_offset + symtab_sz
+                                                                          : strtab_offset + strtab_sz;
+  keep_end = (keep_end + page_sz - 1) & ~(page_sz - 1);
+
+  if (keep_start > 0) munmap(map, keep_start);
+  if (keep_end < map_sz) munmap(map + keep_end, map_sz - keep_end);
+  mprotect(map + keep_start, keep_end - keep_start, PROT_READ);
+
+  // OK
+  self->symtab = (ElfW(Sym) *)(map + symtab_offset);
+  self->symtab_cnt = symtab_sz / sizeof(ElfW(Sym));
+  self->strtab = (char *)(map + strtab_offset);
+  self->strtab_sz = strtab_sz;
+  self->symtab_map = map + keep_start;
+  self->symtab_map_sz = keep_end - keep_start;
+  return 0;
+
+err:
+  munmap(map, map_sz);
+  return -1;
+}
+
+// growing decompression buffer on the handle's allocator
+typedef struct {
+  const xdl_allocator_t *allocator;
+  uint8_t *buf;
+  size_t sz;
+  size_t cap;
+} xdl_debugdata_buf_t;
+
+static int xdl_debugdata_buf_write(const uint8_t *buf, size_t len, void *arg) {
+  xdl_debugdata_buf_t *b = (xdl_debugdata_buf_t *)arg;
+
+  if (len > b->cap - b->sz) {
+    // the allocator has no realloc, move to a doubled buffer
+    size_t cap = b->cap;
+    while (len > cap - b->sz) {
+      if (cap > SIZE_MAX / 2) return -1;
+      cap *= 2;
+    }
+    uint8_t *new_buf = (uint8_t *)xdl_alloc(b->allocator, cap);
+    if (NULL == new_buf) return -1;
+    memcpy(new_buf, b->buf, b->sz);
+    xdl_free(b->allocator, b->buf);
+    b->buf = new_buf;
+    b->cap = cap;
+  }
 
-  // get zipped .gnu_debugdata
-  uint8_t *debugdata_zip = (uint8_t *)xdl_read_file_to_heap_by_section(file_fd, file_sz, shdr_debugdata);
-  if (NULL == debugdata_zip) return -1;
+  memcpy(b->buf + b->sz, buf, len);
+  b->sz += len;
+  return 0;
+}
+
+// decompress into a buffer from the handle's allocator, then copy .symtab & .strtab out
+static int xdl_symtab_load_from_debugdata_to_heap(xdl_t *self, uint8_t *debugdata_zip, size_t debugdata_zip_sz) {
+  xdl_debugdata_buf_t b = {.allocator = &self->allocator, .buf = NULL, .sz = 0, .cap = 0};
+  int r = -1;
 
-  // get unzipped .gnu_debugdata
   size_t debugdata_sz;
-  if (0 != xdl_lzma_decompress(debugdata_zip, shdr_debugdata->sh_size, (uint8_t **)&debugdata, &debugdata_sz))
+  if (0 == xdl_lzma_get_uncompressed_size(debugdata_zip, debugdata_zip_sz, &debugdata_sz)) {
+    // exact size from the xz index
+    if (0 == debugdata_sz || NULL == (b.buf = (uint8_t *)xdl_alloc(b.allocator, debugdata_sz))) return -1;
+    if (0 != xdl_lzma_decompress_to(debugdata_zip, debugdata_zip_sz, b.buf, debugdata_sz)) goto end;
+    b.sz = debugdata_sz;
+  } else {
+    // no usable index, grow from a guess of the compression ratio
+    if (0 == debugdata_zip_sz || debugdata_zip_sz > SIZE_MAX / 4) return -1;
+    b.cap = 4 * debugdata_zip_sz;
+    if (NULL == (b.buf = (uint8_t *)xdl_alloc(b.allocator, b.cap))) return -1;
+    if (0 != xdl_lzma_decompress_stream(debugdata_zip, debugdata_zip_sz, xdl_debugdata_buf_write, &b)) goto end;
+  }
+
+  ElfW(Shdr) *shdr_symtab, *shdr_strtab;
+  if (0 != xdl_elf_find_symtab(b.buf, b.sz, &shdr_symtab, &shdr_strtab)) goto end;
+
+  // get .symtab & .strtab
+  ElfW(Sym) *symtab = (ElfW(Sym) *)xdl_read_memory_to_heap_by_section(&self->allocator, b.buf, b.sz, shdr_symtab);
+  if (NULL == symtab) goto end;
+  char *strtab = (char *)xdl_read_memory_to_heap_by_section(&self->allocator, b.buf, b.sz, shdr_strtab);
+  if (NULL == strtab) {
+    xdl_free(&self->allocator, symtab);
     goto end;
+  }
 
-  // get ELF header
-  ElfW(Ehdr) *ehdr = (ElfW(Ehdr) *)debugdata;
-  if (0 == ehdr->e_shnum || ehdr->e_shentsize != sizeof(ElfW(Shdr))) goto end;
+  // OK
+  self->symtab = symtab;
+  self->symtab_cnt = shdr_symtab->sh_size / sizeof(ElfW(Sym));
+  self->strtab = strtab;
+  self->strtab_sz = shdr_strtab->sh_size;
+  r = 0;
+
+end:
+  xdl_free(&self->allocator, b.buf);
+  return r;
+}
+
+// load from memory
+static int xdl_symtab_load_from_debugdata(xdl_t *self, uint8_t *debugdata_zip, size_t debugdata_zip_sz) {
+  // the size from the xz index avoids the realloc growth and the copies
+  if (0 != xdl_symtab_load_from_debugdata_to_map(self, debugdata_zip, debugdata_zip_sz) &&
+      0 != xdl_symtab_load_from_debugdata_to_heap(self, debugdata_zip, debugdata_zip_sz))
+    return -1;
+  return 0;
+}
+
+// load from disk (mapped read-only), .symtab & .strtab are used in place
+// *in_place: set when the handle keeps file_map, otherwise the caller still owns it
+static int xdl_symtab_load_from_file_map(xdl_t *self, void *file_map, size_t file_sz, ElfW(Ehdr) *ehdr,
+                                         bool *in_place) {
+  *in_place = false;
 
   // get section headers
-  shdrs = (ElfW(Shdr) *)xdl_read_memory_to_heap(debugdata, debugdata_sz, (size_t)ehdr->e_shoff,
-                                                ehdr->e_shentsize * ehdr->e_shnum);
-  if (NULL == shdrs) goto end;
+  if (ehdr->e_shoff > SIZE_MAX - ehdr->e_shentsize * ehdr->e_shnum) return -1;
+  ElfW(Shdr) *shdrs = (ElfW(Shdr) *)xdl_get_memory(file_map, file_sz, (size_t)ehdr->e_shoff,
+                                                   ehdr->e_shentsize * ehdr->e_shnum);
+  if (NULL == shdrs) return -1;
 
   // get .shstrtab
-  if (SHN_UNDEF == ehdr->e_shstrndx || ehdr->e_shstrndx >= ehdr->e_shnum) goto end;
-  char *shstrtab = (char *)xdl_get_memory_by_section(debugdata, debugdata_sz, shdrs + ehdr->e_shstrndx);
-  if (NULL == shstrtab) goto end;
+  if (SHN_UNDEF == ehdr->e_shstrndx || ehdr->e_shstrndx >= ehdr->e_shnum) return -1;
+  ElfW(Shdr) *shdr_shstrtab = shdrs + ehdr->e_shstrndx;
+  char *shstrtab = (char *)xdl_get_memory_by_section(file_map, file_sz, shdr_shstrtab);
+  if (NULL == shstrtab) return -1;
 
   // find .symtab & .strtab
   for (ElfW(Shdr) *shdr = shdrs; shdr < shdrs + ehdr->e_shnum; shdr++) {
+    if (shdr->sh_name >= shdr_shstrtab->sh_size) continue;
     char *shdr_name = shstrtab + shdr->sh_name;
 
     if (SHT_SYMTAB == shdr->sh_type && 0 == strcmp(".symtab", shdr_name)) {
+      if (sizeof(ElfW(Sym)) != shdr->sh_entsize) continue;
+
       // get & check associated .strtab section
       if (shdr->sh_link >= ehdr->e_shnum) continue;
       ElfW(Shdr) *shdr_strtab = shdrs + shdr->sh_link;
       if (SHT_STRTAB != shdr_strtab->sh_type) continue;
 
       // get .symtab & .strtab
-      ElfW(Sym) *symtab = (ElfW(Sym) *)xdl_read_memory_to_heap_by_section(debugdata, debugdata_sz, shdr);
+      ElfW(Sym) *symtab = (ElfW(Sym) *)xdl_get_memory_by_section(file_map, file_sz, shdr);
       if (NULL == symtab) continue;
-      char *strtab = (char *)xdl_read_memory_to_heap_by_section(debugdata, debugdata_sz, shdr_strtab);
-      if (NULL == strtab) {
-        free(symtab);
-        continue;
-      }
+      char *strtab = (char *)xdl_get_memory_by_section(file_map, file_sz, shdr_strtab);
+      if (NULL == strtab) continue;
 
       // OK
       self->symtab = symtab;
       self->symtab_cnt = shdr->sh_size / shdr->sh_entsize;
       self->strtab = strtab;
       self->strtab_sz = shdr_strtab->sh_size;
-      r = 0;
-      break;
+      self->symtab_map = file_map;
+      self->symtab_map_sz = file_sz;
+      *in_place = true;
+      return 0;
+    } else if (SHT_PROGBITS == shdr->sh_type && 0 == strcmp(".gnu_debugdata", shdr_name)) {
+      uint8_t *debugdata_zip = (uint8_t *)xdl_get_memory_by_section(file_map, file_sz, shdr);
+      if (NULL == debugdata_zip) continue;
+      if (0 == xdl_symtab_load_from_debugdata(self, debugdata_zip, shdr->sh_size)) return 0;  // OK
     }
   }
 
-end:
-  free(debugdata_zip);
-  if (NULL != debugdata) free(debugdata);
-  if (NULL != shdrs) free(shdrs);
-  return r;
+  return -1;
 }
 
 // load from disk and memory
@@ -305,6 +715,17 @@ static int xdl_symtab_load(xdl_t *self) {
   if (UINTPTR_MAX == vaddr_min) return -1;
   self->base = self->load_bias + vaddr_min;
 
+  // try the symbol cache first, a hit needs neither the file nor a mapping of it
+  if (!atomic_load_explicit(&self->build_id_try_load, memory_order_relaxed)) {
+    xdl_build_id_init(self);  // under the lock xdl_once() would take
+    atomic_store_explicit(&self->build_id_try_load, true, memory_order_release);
+  }
+  if (NULL != self->build_id && 0 == xdl_symcache_find(self->build_id, self->build_id_sz, &self->symtab,
+                                                       &self->symtab_cnt, &self->strtab, &self->strtab_sz)) {
+    self->symtab_cached = true;
+    return 0;
+  }
+
   // open file
   int flags = O_RDONLY | O_CLOEXEC;
   int file_fd;
@@ -330,14 +751,24 @@ static int xdl_symtab_load(xdl_t *self) {
   ElfW(Ehdr) *ehdr = (ElfW(Ehdr) *)self->base;
   if (0 == ehdr->e_shnum || ehdr->e_shentsize != sizeof(ElfW(Shdr))) goto end;
 
+  // try to map the file, so that .symtab & .strtab are clean page cache shared by all processes
+  void *file_map = mmap(NULL, file_sz, PROT_READ, MAP_PRIVATE, file_fd, 0);
+  if (MAP_FAILED != file_map) {
+    bool in_place;
+    r = xdl_symtab_load_from_file_map(self, file_map, file_sz, ehdr, &in_place);
+    if (!in_place) munmap(file_map, file_sz);  // not found, or decoded from .gnu_debugdata
+    goto end;
+  }
+
+  // fallback: read into heap
   // get section headers
-  shdrs = (ElfW(Shdr) *)xdl_read_file_to_heap(file_fd, file_sz, (size_t)ehdr->e_shoff,
+  shdrs = (ElfW(Shdr) *)xdl_read_file_to_heap(&self->allocator, file_fd, file_sz, (size_t)ehdr->e_shoff,
                                               ehdr->e_shentsize * ehdr->e_shnum);
   if (NULL == shdrs) goto end;
 
   // get .shstrtab
   if (SHN_UNDEF == ehdr->e_shstrndx || ehdr->e_shstrndx >= ehdr->e_shnum) goto end;
-  shstrtab = (char *)xdl_read_file_to_heap_by_section(file_fd, file_sz, shdrs + ehdr->e_shstrndx);
+  shstrtab = (char *)xdl_read_file_to_heap_by_section(&self->allocator, file_fd, file_sz, shdrs + ehdr->e_shstrndx);
   if (NULL == shstrtab) goto end;
 
   // find .symtab & .strtab
@@ -351,11 +782,11 @@ static int xdl_symtab_load(xdl_t *self) {
       if (SHT_STRTAB != shdr_strtab->sh_type) continue;
 
       // get .symtab & .strtab
-      ElfW(Sym) *symtab = (ElfW(Sym) *)xdl_read_file_to_heap_by_section(file_fd, file_sz, shdr);
+      ElfW(Sym) *symtab = (ElfW(Sym) *)xdl_read_file_to_heap_by_section(&self->allocator, file_fd, file_sz, shdr);
       if (NULL == symtab) continue;
-      char *strtab = (char *)xdl_read_file_to_heap_by_section(file_fd, file_sz, shdr_strtab);
+      char *strtab = (char *)xdl_read_file_to_heap_by_section(&self->allocator, file_fd, file_sz, shdr_strtab);
       if (NULL == strtab) {
-        free(symtab);
+        xdl_free(&self->allocator, symtab);
         continue;
       }
 
@@ -367,7 +798,12 @@ static int xdl_symtab_load(xdl_t *self) {
       r = 0;
       break;
     } else if (SHT_PROGBITS == shdr->sh_type && 0 == strcmp(".gnu_debugdata", shdr_name)) {
-      if (0 == xdl_symtab_load_from_debugdata(self, file_fd, file_sz, shdr)) {
+      uint8_t *debugdata_zip =
+          (uint8_t *)xdl_read_file_to_heap_by_section(&self->allocator, file_fd, file_sz, shdr);
+      if (NULL == debugdata_zip) continue;
+      int ret = xdl_symtab_load_from_debugdata(self, debugdata_zip, shdr->sh_size);
+      xdl_free(&self->allocator, debugdata_zip);
+      if (0 == ret) {
         // OK
         r = 0;
         break;
@@ -377,11 +813,31 @@ static int xdl_symtab_load(xdl_t *self) {
 
 end:
   close(file_fd);
-  if (NULL != shdrs) free(shdrs);
-  if (NULL != shstrtab) free(shstrtab);
+  xdl_free(&self->allocator, shdrs);
+  xdl_free(&self->allocator, shstrtab);
   return r;
 }
 
+static void xdl_dynsym_init(xdl_t *self) {
+  xdl_dynsym_load(self);
+}
+
+// load from the mapping of xdl_file_open()
+static int xdl_file_symtab_load(xdl_t *self) {
+  ElfW(Ehdr) *ehdr = (ElfW(Ehdr) *)self->file_map;
+  if (0 == ehdr->e_shnum || ehdr->e_shentsize != sizeof(ElfW(Shdr))) return -1;
+
+  bool in_place;  // the handle owns file_map either way
+  return xdl_symtab_load_from_file_map(self, self->file_map, self->file_sz, ehdr, &in_place);
+}
+
+static void xdl_symtab_init(xdl_t *self) {
+  if (NULL != self->file_map)
+    xdl_file_symtab_load(self);
+  else
+    xdl_symtab_load(self);
+}
+
 static xdl_t *xdl_find_from_auxv(unsigned long type, const char *pathname) {
   if (NULL == getauxval) return NULL;  // API level < 18
 
@@ -410,16 +866,10 @@ static xdl_t *xdl_find_from_auxv(unsigned long type, const char *pathname) {
 
   // create xDL object
   xdl_t *self;
-  if (NULL == (self = calloc(1, sizeof(xdl_t)))) return NULL;
-  if (NULL == (self->pathname = strdup(pathname))) {
-    free(self);
-    return NULL;
-  }
+  if (NULL == (self = xdl_handle_create(pathname, &xdl_thread_allocator))) return NULL;
   self->load_bias = load_bias;
   self->dlpi_phdr = dlpi_phdr;
   self->dlpi_phnum = dlpi_phnum;
-  self->dynsym_try_load = false;
-  self->symtab_try_load = false;
   return self;
 }
 
@@ -451,28 +901,24 @@ static int xdl_find_iterate_cb(struct dl_phdr_info *info, size_t size, void *arg
   }
 
   // found the target ELF
-  if (NULL == ((*self) = calloc(1, sizeof(xdl_t)))) return 1;  // return failed
-  if (NULL == ((*self)->pathname = strdup(info->dlpi_name))) {
-    free(*self);
-    *self = NULL;
-    return 1;  // return failed
-  }
+  if (NULL == ((*self) = xdl_handle_create(info->dlpi_name, &xdl_thread_allocator))) return 1;  // return failed
   (*self)->load_bias = info->dlpi_addr;
   (*self)->dlpi_phdr = info->dlpi_phdr;
   (*self)->dlpi_phnum = info->dlpi_phnum;
-  (*self)->dynsym_try_load = false;
-  (*self)->symtab_try_load = false;
   return 1;  // return OK
 }
 
 static xdl_t *xdl_find(const char *filename) {
   // from auxv (linker, vDSO)
   xdl_t *self = NULL;
+#ifdef __ANDROID__
   if (xdl_util_ends_with(filename, XDL_UTIL_LINKER_BASENAME))
     self = xdl_find_from_auxv(AT_BASE, XDL_UTIL_LINKER_PATHNAME);
-  else if (xdl_util_ends_with(filename, XDL_UTIL_VDSO_BASENAME))
+#endif
+  if (xdl_util_ends_with(filename, XDL_UTIL_VDSO_BASENAME))
     self = xdl_find_from_auxv(AT_SYSINFO_EHDR, XDL_UTIL_VDSO_BASENAME);
 
+#ifdef __ANDROID__
   // from auxv (app_process)
   const char *basename, *pathname;
 #if (defined(__arm__) || defined(__i386__)) && __ANDROID_API__ < __ANDROID_API_L__
@@ -486,11 +932,20 @@ static xdl_t *xdl_find(const char *filename) {
     pathname = XDL_UTIL_APP_PROCESS_PATHNAME;
   }
   if (xdl_util_ends_with(filename, basename)) self = xdl_find_from_auxv(AT_PHDR, pathname);
+#endif
 
   if (NULL != self) return self;
 
-  // from dl_iterate_phdr
+  // from the module registry, a hash lookup while the link map is unchanged
   uintptr_t pkg[2] = {(uintptr_t)&self, (uintptr_t)filename};
+  struct dl_phdr_info info;
+  char buf[PATH_MAX];
+  if (0 == xdl_registry_find(filename, &info, buf, sizeof(buf))) {
+    xdl_find_iterate_cb(&info, sizeof(info), pkg);
+    if (NULL != self) return self;
+  }
+
+  // from dl_iterate_phdr
   xdl_iterate_phdr(xdl_find_iterate_cb, pkg, XDL_DEFAULT);
   return self;
 }
@@ -532,24 +987,85 @@ static void *xdl_open_try_force(const char *filename) {
 void *xdl_open(const char *filename, int flags) {
   if (NULL == filename) return NULL;
 
+  xdl_t *self;
   if (flags & XDL_ALWAYS_FORCE_LOAD)
-    return xdl_open_always_force(filename);
+    self = (xdl_t *)xdl_open_always_force(filename);
   else if (flags & XDL_TRY_FORCE_LOAD)
-    return xdl_open_try_force(filename);
+    self = (xdl_t *)xdl_open_try_force(filename);
   else
-    return xdl_find(filename);
+    self = (xdl_t *)xdl_find(filename);
+
+  if (NULL != self && (flags & XDL_DSYM_INDEX)) self->dsym_index_enabled = true;
+  return (void *)self;
+}
+
+void *xdl_file_open(const char *pathname, int flags) {
+  if (NULL == pathname) return NULL;
+
+  // map the whole file
+  int file_fd = open(pathname, O_RDONLY | O_CLOEXEC);
+  if (file_fd < 0) return NULL;
+  void *file_map = MAP_FAILED;
+  size_t file_sz = 0;
+  struct stat st;
+  if (0 == fstat(file_fd, &st) && st.st_size > 0) {
+    file_sz = (size_t)st.st_size;
+    file_map = mmap(NULL, file_sz, PROT_READ, MAP_PRIVATE, file_fd, 0);
+  }
+  close(file_fd);
+  if (MAP_FAILED == file_map) return NULL;
+
+  // check ELF header
+  ElfW(Ehdr) *ehdr = (ElfW(Ehdr) *)file_map;
+  if (file_sz < sizeof(ElfW(Ehdr)) || 0 != memcmp(ehdr->e_ident, ELFMAG, SELFMAG)) goto err;
+  if (XDL_ELF_CLASS != ehdr->e_ident[EI_CLASS]) goto err;
+  if (ET_DYN != ehdr->e_type && ET_EXEC != ehdr->e_type) goto err;
+  if (ehdr->e_phentsize != sizeof(ElfW(Phdr))) goto err;
+
+  // get program headers
+  const ElfW(Phdr) *dlpi_phdr = (const ElfW(Phdr) *)xdl_get_memory(file_map, file_sz, (size_t)ehdr->e_phoff,
+                                                                   ehdr->e_phentsize * ehdr->e_phnum);
+  if (NULL == dlpi_phdr) goto err;
+
+  xdl_t *self = xdl_handle_create(pathname, &xdl_thread_allocator);
+  if (NULL == self) goto err;
+  self->load_bias = 0;  // so symbol addresses are vaddrs
+  self->dlpi_phdr = dlpi_phdr;
+  self->dlpi_phnum = ehdr->e_phnum;
+  self->file_map = file_map;
+  self->file_sz = file_sz;
+  if (flags & XDL_DSYM_INDEX) self->dsym_index_enabled = true;
+  return (void *)self;
+
+err:
+  munmap(file_map, file_sz);
+  return NULL;
 }
 
 void *xdl_close(void *handle) {
   if (NULL == handle) return NULL;
 
   xdl_t *self = (xdl_t *)handle;
-  if (NULL != self->pathname) free(self->pathname);
-  if (NULL != self->symtab) free(self->symtab);
-  if (NULL != self->strtab) free(self->strtab);
+  xdl_allocator_t allocator = self->allocator;
+  xdl_free(&allocator, self->pathname);
+  if (self->symtab_cached) {
+    // owned by the symbol cache
+  } else if (NULL == self->symtab_map) {
+    xdl_free(&allocator, self->symtab);
+    xdl_free(&allocator, self->strtab);
+  } else if (self->file_map != self->symtab_map) {
+    munmap(self->symtab_map, self->symtab_map_sz);
+  }
+  if (NULL != self->file_map) munmap(self->file_map, self->file_sz);
+  xdl_free(&allocator, self->dsym_index.buckets);
+  xdl_free(&allocator, self->dsym_index.chains);
+  xdl_free(&allocator, self->dsym_index.hashes);
+  xdl_free(&allocator, self->dynsym_addr_index.entries);
+  xdl_free(&allocator, self->symtab_addr_index.entries);
 
   void *linker_handle = self->linker_handle;
-  free(self);
+  pthread_mutex_destroy(&self->lock);
+  xdl_free(&allocator, self);
   return linker_handle;
 }
 
@@ -574,22 +1090,28 @@ static uint32_t xdl_gnu_hash(const uint8_t *name) {
   return h;
 }
 
-static ElfW(Sym) *xdl_dynsym_find_symbol_use_sysv_hash(xdl_t *self, const char *sym_name) {
-  uint32_t hash = xdl_sysv_hash((const uint8_t *)sym_name);
+// sym_name does not need to be NUL-terminated
+static inline bool xdl_dynsym_name_equals(xdl_t *self, ElfW(Sym) *sym, const char *sym_name,
+                                          size_t sym_name_len) {
+  if (sym->st_name >= self->dynstr_sz || self->dynstr_sz - sym->st_name <= sym_name_len) return false;
+  const char *name = self->dynstr + sym->st_name;
+  return 0 == strncmp(name, sym_name, sym_name_len) && '\0' == name[sym_name_len];
+}
 
+static ElfW(Sym) *xdl_dynsym_find_symbol_use_sysv_hash(xdl_t *self, const char *sym_name, size_t sym_name_len,
+                                                       uint32_t hash) {
   for (uint32_t i = self->sysv_hash.buckets[hash % self->sysv_hash.buckets_cnt]; 0 != i;
        i = self->sysv_hash.chains[i]) {
     ElfW(Sym) *sym = self->dynsym + i;
-    if (0 != strcmp(self->dynstr + sym->st_name, sym_name)) continue;
+    if (!xdl_dynsym_name_equals(self, sym, sym_name, sym_name_len)) continue;
     return sym;
   }
 
   return NULL;
 }
 
-static ElfW(Sym) *xdl_dynsym_find_symbol_use_gnu_hash(xdl_t *self, const char *sym_name) {
-  uint32_t hash = xdl_gnu_hash((const uint8_t *)sym_name);
-
+static ElfW(Sym) *xdl_dynsym_find_symbol_use_gnu_hash(xdl_t *self, const char *sym_name, size_t sym_name_len,
+                                                      uint32_t hash) {
   static uint32_t elfclass_bits = sizeof(ElfW(Addr)) * 8;
   size_t word = self->gnu_hash.bloom[(hash / elfclass_bits) % self->gnu_hash.bloom_cnt];
   size_t mask = 0 | (size_t)1 << (hash % elfclass_bits) |
@@ -608,7 +1130,7 @@ static ElfW(Sym) *xdl_dynsym_find_symbol_use_gnu_hash(xdl_t *self, const char *s
     uint32_t sym_hash = self->gnu_hash.chains[i - self->gnu_hash.symoffset];
 
     if ((hash | (uint32_t)1) == (sym_hash | (uint32_t)1)) {
-      if (0 == strcmp(self->dynstr + sym->st_name, sym_name)) {
+      if (xdl_dynsym_name_equals(self, sym, sym_name, sym_name_len)) {
         return sym;
       }
     }
@@ -622,28 +1144,23 @@ static ElfW(Sym) *xdl_dynsym_find_symbol_use_gnu_hash(xdl_t *self, const char *s
   return NULL;
 }
 
-void *xdl_sym(void *handle, const char *symbol, size_t *symbol_size) {
-  if (NULL == handle || NULL == symbol) return NULL;
-  if (NULL != symbol_size) *symbol_size = 0;
-
-  xdl_t *self = (xdl_t *)handle;
-
+// sysv_hash is only computed (from a NUL-terminated symbol) when needed and not given
+static void *xdl_sym_with_hash(xdl_t *self, const char *symbol, size_t symbol_len, uint32_t gnu_hash,
+                               const uint32_t *sysv_hash, size_t *symbol_size) {
   // load .dynsym only once
-  if (!self->dynsym_try_load) {
-    self->dynsym_try_load = true;
-    if (0 != xdl_dynsym_load(self)) return NULL;
-  }
+  xdl_once(self, &self->dynsym_try_load, xdl_dynsym_init);
 
   // find symbol
   if (NULL == self->dynsym) return NULL;
   ElfW(Sym) *sym = NULL;
   if (self->gnu_hash.buckets_cnt > 0) {
     // use GNU hash (.gnu.hash -> .dynsym -> .dynstr), O(x) + O(1) + O(1)
-    sym = xdl_dynsym_find_symbol_use_gnu_hash(self, symbol);
+    sym = xdl_dynsym_find_symbol_use_gnu_hash(self, symbol, symbol_len, gnu_hash);
   }
   if (NULL == sym && self->sysv_hash.buckets_cnt > 0) {
     // use SYSV hash (.hash -> .dynsym -> .dynstr), O(x) + O(1) + O(1)
-    sym = xdl_dynsym_find_symbol_use_sysv_hash(self, symbol);
+    sym = xdl_dynsym_find_symbol_use_sysv_hash(
+        self, symbol, symbol_len, NULL != sysv_hash ? *sysv_hash : xdl_sysv_hash((const uint8_t *)symbol));
   }
   if (NULL == sym || !XDL_DYNSYM_IS_EXPORT_SYM(sym->st_shndx)) return NULL;
 
@@ -651,44 +1168,157 @@ void *xdl_sym(void *handle, const char *symbol, size_t *symbol_size) {
   return (void *)(self->load_bias + sym->st_value);
 }
 
-// clang-format off
-/*
- * For internal symbols in .symtab, LLVM may add some suffixes (for example for thinLTO).
- * The format of the suffix is: ".xxxx.[hash]". LLVM may add multiple suffixes at once.
- * The symbol name after removing these all suffixes is called canonical name.
- *
- * Because the hash part in the suffix may change when recompiled, so here we only match
- * the canonical name.
- *
- * IN ADDITION: According to C/C++ syntax, it is illegal for a function name to contain
- * dot character('.'), either in the middle or at the end.
- *
- * samples:
- *
- * symbol name in .symtab          lookup                       is match
- * ----------------------          ----------------             --------
- * abcd                            abc                          N
- * abcd                            abcd                         Y
- * abcd.llvm.10190306339727611508  abc                          N
- * abcd.llvm.10190306339727611508  abcd                         Y
- * abcd.llvm.10190306339727611508  abcd.                        N
- * abcd.llvm.10190306339727611508  abcd.llvm                    Y
- * abcd.llvm.10190306339727611508  abcd.llvm.                   N
- * abcd.__uniq.513291356003753     abcd.__uniq.51329            N
- * abcd.__uniq.513291356003753     abcd.__uniq.513291356003753  Y
- */
-// clang-format on
-static inline bool xdl_dsym_is_match(const char *str, const char *sym, size_t str_len) {
-  if (__predict_false(0 == str_len)) return false;
-
-  do {
-    if (*str != *sym) return __predict_false('.' == *str && '\0' == *sym);
-    str++;
-    sym++;
-    if ('\0' == *str) break;
-  } while (0 != --str_len);
-
-  return true;
+void *xdl_sym(void *handle, const char *symbol, size_t *symbol_size) {
+  if (NULL == handle || NULL == symbol) return NULL;
+  if (NULL != symbol_size) *symbol_size = 0;
+
+  return xdl_sym_with_hash((xdl_t *)handle, symbol, strlen(symbol), xdl_gnu_hash((const uint8_t *)symbol), NULL,
+                           symbol_size);
+}
+
+void *xdl_sym_hashed(void *handle, const char *symbol, size_t symbol_len, uint32_t gnu_hash, uint32_t sysv_hash,
+                     size_t *symbol_size) {
+  if (NULL == handle || NULL == symbol) return NULL;
+  if (NULL != symbol_size) *symbol_size = 0;
+
+  return xdl_sym_with_hash((xdl_t *)handle, symbol, symbol_len, gnu_hash, &sysv_hash, symbol_size);
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+
+typedef struct {
+  const char *symbol;
+  size_t symbol_len;
+  uint32_t gnu_hash;
+  uint32_t sysv_hash;  // computed for the first ELF without GNU hash
+  bool sysv_hash_done;
+  void *addr;
+  size_t size;
+} xdl_sym_global_t;
+
+#pragma clang diagnostic pop
+
+static int xdl_sym_global_cb(struct dl_phdr_info *info, void *arg) {
+  xdl_sym_global_t *query = (xdl_sym_global_t *)arg;
+
+  // only .dynsym is used, and loading it allocates nothing
+  xdl_t self;
+  memset(&self, 0, sizeof(xdl_t));
+  self.load_bias = info->dlpi_addr;
+  self.dlpi_phdr = info->dlpi_phdr;
+  self.dlpi_phnum = info->dlpi_phnum;
+  if (0 != xdl_dynsym_load(&self)) return 0;  // nothing to look up in this ELF
+
+  ElfW(Sym) *sym;
+  if (self.gnu_hash.buckets_cnt > 0) {
+    sym = xdl_dynsym_find_symbol_use_gnu_hash(&self, query->symbol, query->symbol_len, query->gnu_hash);
+  } else {
+    if (!query->sysv_hash_done) {
+      query->sysv_hash = xdl_sysv_hash((const uint8_t *)query->symbol);
+      query->sysv_hash_done = true;
+    }
+    sym = xdl_dynsym_find_symbol_use_sysv_hash(&self, query->symbol, query->symbol_len, query->sysv_hash);
+  }
+  if (NULL == sym || !XDL_DYNSYM_IS_EXPORT_SYM(sym->st_shndx)) return 0;
+
+  // found
+  query->addr = (void *)(self.load_bias + sym->st_value);
+  query->size = sym->st_size;
+  return 1;
+}
+
+void *xdl_sym_global(const char *symbol, size_t *symbol_size) {
+  if (NULL == symbol) return NULL;
+  if (NULL != symbol_size) *symbol_size = 0;
+
+  // the registry snapshot rejects most ELFs with the bloom words it keeps side by side
+  xdl_sym_global_t query = {.symbol = symbol, .symbol_len = strlen(symbol)};
+  query.gnu_hash = xdl_gnu_hash((const uint8_t *)symbol);
+  if (1 != xdl_registry_iterate_by_gnu_hash(query.gnu_hash, xdl_sym_global_cb, &query)) return NULL;
+
+  if (NULL != symbol_size) *symbol_size = query.size;
+  return query.addr;
+}
+
+// GNU hash of the canonical name: everything before the first '.'
+//
+// A lookup and a .symtab name that xdl_dsym_is_match() accepts always share the same
+// canonical name, so both sides can be hashed with this.
+static uint32_t xdl_dsym_canonical_hash(const char *name, size_t max_len) {
+  uint32_t h = 5381;
+
+  for (; max_len > 0 && '\0' != *name && '.' != *name; name++, max_len--) {
+    h += (h << 5) + (uint8_t)*name;
+  }
+  return h;
+}
+
+static void xdl_dsym_index_build(xdl_t *self) {
+  if (self->symtab_cnt > UINT32_MAX - 1) return;
+  uint32_t cnt = (uint32_t)self->symtab_cnt;
+
+  uint32_t buckets_cnt = 1;
+  while (buckets_cnt < cnt && buckets_cnt < (UINT32_MAX >> 1) + 1) buckets_cnt <<= 1;
+
+  uint32_t *buckets = (uint32_t *)xdl_calloc(&self->allocator, buckets_cnt, sizeof(uint32_t));
+  uint32_t *chains = (uint32_t *)xdl_calloc(&self->allocator, cnt, sizeof(uint32_t));
+  uint32_t *hashes = (uint32_t *)xdl_calloc(&self->allocator, cnt, sizeof(uint32_t));
+  if (NULL == buckets || NULL == chains || NULL == hashes) {
+    xdl_free(&self->allocator, buckets);
+    xdl_free(&self->allocator, chains);
+    xdl_free(&self->allocator, hashes);
+    return;
+  }
+
+  // insert backwards so that each chain is in ascending symtab order, like the linear scan
+  for (uint32_t i = cnt; i > 0; i--) {
+    ElfW(Sym) *sym = self->symtab + (i - 1);
+    if (!XDL_SYMTAB_IS_EXPORT_SYM(sym->st_shndx)) continue;
+    if (sym->st_name >= self->strtab_sz) continue;
+
+    uint32_t hash = xdl_dsym_canonical_hash(self->strtab + sym->st_name, self->strtab_sz - sym->st_name);
+    uint32_t *bucket = &buckets[hash & (buckets_cnt - 1)];
+    hashes[i - 1] = hash;
+    chains[i - 1] = *bucket;
+    *bucket = i;
+  }
+
+  self->dsym_index.buckets = buckets;
+  self->dsym_index.buckets_cnt = buckets_cnt;
+  self->dsym_index.chains = chains;
+  self->dsym_index.hashes = hashes;
+}
+
+static ElfW(Sym) *xdl_dsym_index_find(xdl_t *self, const char *symbol) {
+  uint32_t hash = xdl_dsym_canonical_hash(symbol, SIZE_MAX);
+
+  for (uint32_t i = self->dsym_index.buckets[hash & (self->dsym_index.buckets_cnt - 1)]; 0 != i;
+       i = self->dsym_index.chains[i - 1]) {
+    if (self->dsym_index.hashes[i - 1] != hash) continue;
+
+    ElfW(Sym) *sym = self->symtab + (i - 1);
+    if (xdl_dsym_is_match(self->strtab + sym->st_name, symbol, self->strtab_sz - sym->st_name)) return sym;
+  }
+  return NULL;
+}
+
+// answer from the symbol offset table, without loading .symtab
+// return 0 for a hit, 1 for a known miss (the symbol is not in .symtab), -1 when the table does not cover it
+static int xdl_symoff_lookup(xdl_t *self, const char *symbol, void **addr, size_t *symbol_size) {
+  // once .symtab is loaded it answers by itself
+  if (atomic_load_explicit(&self->symtab_try_load, memory_order_acquire) && NULL != self->symtab) return -1;
+
+  xdl_once(self, &self->build_id_try_load, xdl_build_id_init);
+  if (NULL == self->build_id) return -1;
+
+  uint64_t value, size;
+  if (0 != xdl_symoff_find(self->build_id, self->build_id_sz, symbol, &value, &size)) return -1;
+  if (XDL_SYMOFF_ABSENT == value) return 1;
+
+  *addr = (void *)(self->load_bias + (uintptr_t)value);
+  *symbol_size = (size_t)size;
+  return 0;
 }
 
 void *xdl_dsym(void *handle, const char *symbol, size_t *symbol_size) {
@@ -697,18 +1327,43 @@ void *xdl_dsym(void *handle, const char *symbol, size_t *symbol_size) {
 
   xdl_t *self = (xdl_t *)handle;
 
-  // load .symtab only once
-  if (!self->symtab_try_load) {
-    self->symtab_try_load = true;
-    if (0 != xdl_symtab_load(self)) return NULL;
+  // resolved ahead of time by another process?
+  void *addr;
+  size_t size;
+  int r = xdl_symoff_lookup(self, symbol, &addr, &size);
+  if (1 == r) return NULL;  // known miss
+  if (0 == r) {
+    if (NULL != symbol_size) *symbol_size = size;
+    return addr;
   }
 
+  // load .symtab only once
+  xdl_once(self, &self->symtab_try_load, xdl_symtab_init);
+
   // find symbol
   if (NULL == self->symtab) return NULL;
+
+  // build the hash index only once, O(1) per lookup after that
+  if (self->dsym_index_enabled) xdl_once(self, &self->dsym_index.try_build, xdl_dsym_index_build);
+  if (NULL != self->dsym_index.buckets) {
+    ElfW(Sym) *sym = xdl_dsym_index_find(self, symbol);
+    if (NULL == sym) return NULL;
+
+    if (NULL != symbol_size) *symbol_size = sym->st_size;
+    return (void *)(self->load_bias + sym->st_value);
+  }
+
+  // fallback: linear scan, O(n)
+  // every byte of the lookup has to match, so its head is a safe prefilter
+  xdl_prefix16_t prefix;
+  xdl_prefix16_init(&prefix, symbol, strlen(symbol));
   for (size_t i = 0; i < self->symtab_cnt; i++) {
     ElfW(Sym) *sym = self->symtab + i;
 
     if (!XDL_SYMTAB_IS_EXPORT_SYM(sym->st_shndx)) continue;
+    if (prefix.len > 0 && self->strtab_sz >= 16 && sym->st_name <= self->strtab_sz - 16 &&
+        !xdl_prefix16_may_match(&prefix, self->strtab + sym->st_name))
+      continue;
     // if (0 != strncmp(self->strtab + sym->st_name, symbol, self->strtab_sz - sym->st_name)) continue;
     if (!xdl_dsym_is_match(self->strtab + sym->st_name, symbol, self->strtab_sz - sym->st_name)) continue;
 
@@ -719,6 +1374,320 @@ void *xdl_dsym(void *handle, const char *symbol, size_t *symbol_size) {
   return NULL;
 }
 
+// open addressing table of the names which are still missing, keyed by canonical name hash
+typedef struct {
+  uint32_t hash;
+  size_t name_idx;  // SIZE_MAX for empty slot
+} xdl_sym_batch_slot_t;
+
+static size_t xdl_sym_batch_dynsym(xdl_t *self, const char **names, size_t n, bool *resolved, void **out_addrs,
+                                   size_t *out_sizes) {
+  size_t found = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (resolved[i]) continue;
+
+    ElfW(Sym) *sym = NULL;
+    size_t name_len = strlen(names[i]);
+    if (self->gnu_hash.buckets_cnt > 0)
+      sym = xdl_dynsym_find_symbol_use_gnu_hash(self, names[i], name_len, xdl_gnu_hash((const uint8_t *)names[i]));
+    if (NULL == sym && self->sysv_hash.buckets_cnt > 0)
+      sym = xdl_dynsym_find_symbol_use_sysv_hash(self, names[i], name_len,
+                                                 xdl_sysv_hash((const uint8_t *)names[i]));
+    if (NULL == sym || !XDL_DYNSYM_IS_EXPORT_SYM(sym->st_shndx)) continue;
+
+    resolved[i] = true;
+    out_addrs[i] = (void *)(self->load_bias + sym->st_value);
+    if (NULL != out_sizes) out_sizes[i] = sym->st_size;
+    found++;
+  }
+  return found;
+}
+
+static size_t xdl_sym_batch_symtab(xdl_t *self, const char **names, size_t n, bool *resolved, void **out_addrs,
+                                   size_t *out_sizes, size_t missing) {
+  // with the hash index, every name is O(1) anyway
+  if (NULL != self->dsym_index.buckets) {
+    size_t found = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (resolved[i]) continue;
+      ElfW(Sym) *sym = xdl_dsym_index_find(self, names[i]);
+      if (NULL == sym) continue;
+
+      resolved[i] = true;
+      out_addrs[i] = (void *)(self->load_bias + sym->st_value);
+      if (NULL != out_sizes) out_sizes[i] = sym->st_size;
+      found++;
+    }
+    return found;
+  }
+
+  size_t slots_cnt = 1;
+  while (slots_cnt < missing * 2) slots_cnt <<= 1;
+  xdl_sym_batch_slot_t *slots = (xdl_sym_batch_slot_t *)malloc(slots_cnt * sizeof(xdl_sym_batch_slot_t));
+  if (NULL == slots) return 0;
+  for (size_t i = 0; i < slots_cnt; i++) slots[i].name_idx = SIZE_MAX;
+  for (size_t i = 0; i < n; i++) {
+    if (resolved[i]) continue;
+    uint32_t hash = xdl_dsym_canonical_hash(names[i], SIZE_MAX);
+    size_t j = hash & (slots_cnt - 1);
+    while (SIZE_MAX != slots[j].name_idx) j = (j + 1) & (slots_cnt - 1);
+    slots[j].hash = hash;
+    slots[j].name_idx = i;
+  }
+
+  // one pass over .symtab, the first match of each name wins (same as xdl_dsym())
+  size_t found = 0;
+  for (size_t i = 0; i < self->symtab_cnt && found < missing; i++) {
+    ElfW(Sym) *sym = self->symtab + i;
+    if (!XDL_SYMTAB_IS_EXPORT_SYM(sym->st_shndx)) continue;
+    if (sym->st_name >= self->strtab_sz) continue;
+
+    const char *str = self->strtab + sym->st_name;
+    size_t str_len = self->strtab_sz - sym->st_name;
+    uint32_t hash = xdl_dsym_canonical_hash(str, str_len);
+    for (size_t j = hash & (slots_cnt - 1); SIZE_MAX != slots[j].name_idx; j = (j + 1) & (slots_cnt - 1)) {
+      size_t name_idx = slots[j].name_idx;
+      if (slots[j].hash != hash || resolved[name_idx]) continue;
+      if (!xdl_dsym_is_match(str, names[name_idx], str_len)) continue;
+
+      resolved[name_idx] = true;
+      out_addrs[name_idx] = (void *)(self->load_bias + sym->st_value);
+      if (NULL != out_sizes) out_sizes[name_idx] = sym->st_size;
+      found++;
+    }
+  }
+
+  free(slots);
+  return found;
+}
+
+#define XDL_SYM_BATCH_STACK_NAMES 64
+
+int xdl_sym_batch(void *handle, const char **names, size_t n, void **out_addrs, size_t *out_sizes, int flags) {
+  if (NULL == handle || NULL == names || NULL == out_addrs) return -1;
+  if (0 == (flags & (XDL_BATCH_DYNSYM | XDL_BATCH_SYMTAB))) flags |= XDL_BATCH_DYNSYM | XDL_BATCH_SYMTAB;
+
+  xdl_t *self = (xdl_t *)handle;
+  size_t missing = 0;
+  for (size_t i = 0; i < n; i++) {
+    out_addrs[i] = NULL;
+    if (NULL != out_sizes) out_sizes[i] = 0;
+    if (NULL != names[i]) missing++;
+  }
+  if (missing < n) return -1;
+
+  // a symbol may resolve to NULL (e.g. st_value 0 in a file handle), so out_addrs cannot tell what is left
+  bool stack_resolved[XDL_SYM_BATCH_STACK_NAMES] = {false};
+  bool *resolved = stack_resolved;
+  if (n > XDL_SYM_BATCH_STACK_NAMES) {
+    if (NULL == (resolved = (bool *)calloc(n, sizeof(bool)))) return -1;
+  }
+
+  // .dynsym first, O(1) for each name
+  if (flags & XDL_BATCH_DYNSYM) {
+    xdl_once(self, &self->dynsym_try_load, xdl_dynsym_init);
+    if (NULL != self->dynsym) missing -= xdl_sym_batch_dynsym(self, names, n, resolved, out_addrs, out_sizes);
+  }
+
+  // then the symbol offset table, and .symtab for the rest, O(n) once for all names
+  if ((flags & XDL_BATCH_SYMTAB) && missing > 0) {
+    size_t unknown = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (resolved[i]) continue;
+      void *addr;
+      size_t size;
+      int r = xdl_symoff_lookup(self, names[i], &addr, &size);
+      if (1 == r) continue;  // known miss
+      if (0 != r) {
+        unknown++;
+        continue;
+      }
+
+      resolved[i] = true;
+      out_addrs[i] = addr;
+      if (NULL != out_sizes) out_sizes[i] = size;
+      missing--;
+    }
+
+    if (unknown > 0) {
+      xdl_once(self, &self->symtab_try_load, xdl_symtab_init);
+      if (self->dsym_index_enabled && NULL != self->symtab)
+        xdl_once(self, &self->dsym_index.try_build, xdl_dsym_index_build);
+      if (NULL != self->symtab)
+        missing -= xdl_sym_batch_symtab(self, names, n, resolved, out_addrs, out_sizes, missing);
+    }
+  }
+
+  if (resolved != stack_resolved) free(resolved);
+  return (int)missing;
+}
+
+#define XDL_PREWARM_MAX_THREADS 4
+
+typedef struct {
+  xdl_t **handles;
+  size_t handles_cnt;
+  atomic_size_t next;
+} xdl_prewarm_t;
+
+// every worker (and the caller) takes the next handle until none is left
+static void *xdl_prewarm_worker(void *arg) {
+  xdl_prewarm_t *prewarm = (xdl_prewarm_t *)arg;
+
+  size_t i;
+  while ((i = atomic_fetch_add_explicit(&prewarm->next, 1, memory_order_relaxed)) < prewarm->handles_cnt) {
+    xdl_t *self = prewarm->handles[i];
+    if (NULL == self) continue;
+
+    xdl_once(self, &self->dynsym_try_load, xdl_dynsym_init);
+    xdl_once(self, &self->symtab_try_load, xdl_symtab_init);
+    if (self->dsym_index_enabled && NULL != self->symtab)
+      xdl_once(self, &self->dsym_index.try_build, xdl_dsym_index_build);
+  }
+  return NULL;
+}
+
+int xdl_prewarm(void **handles, size_t n) {
+  if (NULL == handles) return -1;
+
+  xdl_prewarm_t prewarm;
+  prewarm.handles = (xdl_t **)handles;
+  prewarm.handles_cnt = n;
+  atomic_init(&prewarm.next, 0);
+
+  size_t threads_cnt = n < XDL_PREWARM_MAX_THREADS ? n : XDL_PREWARM_MAX_THREADS;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (cpus > 0 && threads_cnt > (size_t)cpus) threads_cnt = (size_t)cpus;
+
+  pthread_t threads[XDL_PREWARM_MAX_THREADS];
+  bool started[XDL_PREWARM_MAX_THREADS];
+  for (size_t t = 1; t < threads_cnt; t++)
+    started[t] = (0 == pthread_create(&threads[t], NULL, xdl_prewarm_worker, &prewarm));
+  xdl_prewarm_worker(&prewarm);
+  for (size_t t = 1; t < threads_cnt; t++)
+    if (started[t]) pthread_join(threads[t], NULL);
+
+  int missing = 0;
+  for (size_t i = 0; i < n; i++)
+    if (NULL != handles[i] && NULL == ((xdl_t *)handles[i])->symtab) missing++;
+  return missing;
+}
+
+int xdl_symoff_create(const char *pathname, const xdl_symoff_spec_t *specs, size_t specs_cnt) {
+  if (NULL == pathname || (NULL == specs && specs_cnt > 0)) return -1;
+
+  int r = -1;
+  xdl_t **handles = (xdl_t **)calloc(specs_cnt + 1, sizeof(xdl_t *));
+  xdl_symoff_lib_t *libs = (xdl_symoff_lib_t *)calloc(specs_cnt + 1, sizeof(xdl_symoff_lib_t));
+  void **addrs = NULL;
+  size_t *sizes = NULL;
+  bool *resolved = NULL;
+  size_t libs_cnt = 0;
+  if (NULL == handles || NULL == libs) goto end;
+
+  for (size_t i = 0; i < specs_cnt; i++) {
+    const xdl_symoff_spec_t *spec = &specs[i];
+    if (NULL == spec->pathname || NULL == spec->symbols || 0 == spec->symbols_cnt) continue;
+    xdl_t *self = handles[i] = (xdl_t *)xdl_file_open(spec->pathname, XDL_DEFAULT);
+    if (NULL == self) continue;
+
+    xdl_symoff_lib_t *lib = &libs[libs_cnt];
+    lib->build_id = xdl_get_build_id(self, &lib->build_id_sz);
+    if (NULL == lib->build_id) continue;
+
+    bool names_ok = true;
+    for (size_t j = 0; j < spec->symbols_cnt; j++)
+      if (NULL == spec->symbols[j]) names_ok = false;
+    if (!names_ok) continue;
+
+    // the same lookup as xdl_dsym(), addresses of a file handle are st_value (0 is a valid one)
+    addrs = (void **)calloc(spec->symbols_cnt, sizeof(void *));
+    sizes = (size_t *)calloc(spec->symbols_cnt, sizeof(size_t));
+    resolved = (bool *)calloc(spec->symbols_cnt, sizeof(bool));
+    uint64_t *values = (uint64_t *)calloc(spec->symbols_cnt * 2, sizeof(uint64_t));
+    if (NULL == addrs || NULL == sizes || NULL == resolved || NULL == values) {
+      free(values);
+      goto end;
+    }
+    xdl_once(self, &self->symtab_try_load, xdl_symtab_init);
+    if (NULL != self->symtab) {
+      xdl_sym_batch_symtab(self, spec->symbols, spec->symbols_cnt, resolved, addrs, sizes, spec->symbols_cnt);
+      for (size_t j = 0; j < spec->symbols_cnt; j++) {
+        values[j] = resolved[j] ? (uint64_t)(uintptr_t)addrs[j] : XDL_SYMOFF_ABSENT;
+        values[spec->symbols_cnt + j] = (uint64_t)sizes[j];
+      }
+      lib->names = spec->symbols;
+      lib->values = values;
+      lib->sizes = values + spec->symbols_cnt;
+      lib->cnt = spec->symbols_cnt;
+      libs_cnt++;
+    } else {
+      free(values);
+    }
+    free(addrs);
+    free(sizes);
+    free(resolved);
+    addrs = NULL;
+    sizes = NULL;
+    resolved = NULL;
+  }
+
+  r = xdl_symoff_save(pathname, libs, libs_cnt);
+
+end:
+  free(addrs);
+  free(sizes);
+  free(resolved);
+  if (NULL != libs) {
+    for (size_t i = 0; i < libs_cnt; i++) free((void *)libs[i].values);
+    free(libs);
+  }
+  if (NULL != handles) {
+    for (size_t i = 0; i < specs_cnt; i++) xdl_close(handles[i]);
+    free(handles);
+  }
+  return r;
+}
+
+int xdl_symcache_create(const char *pathname, const char **elfs, size_t elfs_cnt) {
+  if (NULL == pathname || (NULL == elfs && elfs_cnt > 0)) return -1;
+
+  int r = -1;
+  xdl_t **handles = (xdl_t **)calloc(elfs_cnt + 1, sizeof(xdl_t *));
+  xdl_symcache_lib_t *libs = (xdl_symcache_lib_t *)calloc(elfs_cnt + 1, sizeof(xdl_symcache_lib_t));
+  size_t libs_cnt = 0;
+  if (NULL == handles || NULL == libs) goto end;
+
+  // the tables are saved from the handles, so they stay open until then
+  for (size_t i = 0; i < elfs_cnt; i++) {
+    if (NULL == elfs[i]) continue;
+    xdl_t *self = handles[i] = (xdl_t *)xdl_file_open(elfs[i], XDL_DEFAULT);
+    if (NULL == self) continue;
+
+    xdl_symcache_lib_t *lib = &libs[libs_cnt];
+    lib->build_id = xdl_get_build_id(self, &lib->build_id_sz);
+    if (NULL == lib->build_id) continue;
+    xdl_once(self, &self->symtab_try_load, xdl_symtab_init);
+    if (NULL == self->symtab) continue;
+
+    lib->symtab = self->symtab;
+    lib->symtab_cnt = self->symtab_cnt;
+    lib->strtab = self->strtab;
+    lib->strtab_sz = self->strtab_sz;
+    libs_cnt++;
+  }
+
+  r = xdl_symcache_save(pathname, libs, libs_cnt);
+
+end:
+  free(libs);
+  if (NULL != handles) {
+    for (size_t i = 0; i < elfs_cnt; i++) xdl_close(handles[i]);
+    free(handles);
+  }
+  return r;
+}
+
 static bool xdl_elf_is_match(uintptr_t load_bias, const ElfW(Phdr) *dlpi_phdr, ElfW(Half) dlpi_phnum,
                              uintptr_t addr) {
   if (addr < load_bias) return false;
@@ -743,17 +1712,10 @@ static int xdl_open_by_addr_iterate_cb(struct dl_phdr_info *info, size_t size, v
 
   if (xdl_elf_is_match(info->dlpi_addr, info->dlpi_phdr, info->dlpi_phnum, addr)) {
     // found the target ELF
-    if (NULL == ((*self) = calloc(1, sizeof(xdl_t)))) return 1;  // failed
-    if (NULL == ((*self)->pathname = strdup(info->dlpi_name))) {
-      free(*self);
-      *self = NULL;
-      return 1;  // failed
-    }
+    if (NULL == ((*self) = xdl_handle_create(info->dlpi_name, &xdl_thread_allocator))) return 1;  // failed
     (*self)->load_bias = info->dlpi_addr;
     (*self)->dlpi_phdr = info->dlpi_phdr;
     (*self)->dlpi_phnum = info->dlpi_phnum;
-    (*self)->dynsym_try_load = false;
-    (*self)->symtab_try_load = false;
     return 1;  // OK
   }
 
@@ -770,29 +1732,130 @@ static void *xdl_open_by_addr(void *addr) {
   return (void *)self;
 }
 
-static bool xdl_sym_is_match(ElfW(Sym) *sym, uintptr_t offset, bool is_symtab) {
+static bool xdl_sym_is_addr_sym(ElfW(Sym) *sym, bool is_symtab) {
   if (is_symtab) {
-    if (!XDL_SYMTAB_IS_EXPORT_SYM(sym->st_shndx)) false;
+    if (!XDL_SYMTAB_IS_EXPORT_SYM(sym->st_shndx)) return false;
   } else {
-    if (!XDL_DYNSYM_IS_EXPORT_SYM(sym->st_shndx)) false;
+    if (!XDL_DYNSYM_IS_EXPORT_SYM(sym->st_shndx)) return false;
   }
 
-  return ELF_ST_TYPE(sym->st_info) != STT_TLS && offset >= sym->st_value &&
+  return ELF_ST_TYPE(sym->st_info) != STT_TLS && sym->st_size > 0;
+}
+
+static bool xdl_sym_is_match(ElfW(Sym) *sym, uintptr_t offset, bool is_symtab) {
+  return xdl_sym_is_addr_sym(sym, is_symtab) && offset >= sym->st_value &&
          offset < sym->st_value + sym->st_size;
 }
 
-static ElfW(Sym) *xdl_sym_by_addr(void *handle, void *addr) {
+static int xdl_addr_entry_cmp(const void *a, const void *b) {
+  const xdl_addr_entry_t *ea = (const xdl_addr_entry_t *)a;
+  const xdl_addr_entry_t *eb = (const xdl_addr_entry_t *)b;
+  if (ea->start != eb->start) return ea->start < eb->start ? -1 : 1;
+  if (ea->idx != eb->idx) return ea->idx < eb->idx ? -1 : 1;
+  return 0;
+}
+
+// sort symbols [sym_begin, sym_end) by address, O(n log n) once per handle
+static void xdl_addr_index_build(xdl_t *self, xdl_addr_index_t *index, ElfW(Sym) *syms, size_t sym_begin,
+                                 size_t sym_end, bool is_symtab) {
+  size_t cnt = 0;
+  for (size_t i = sym_begin; i < sym_end; i++)
+    if (xdl_sym_is_addr_sym(syms + i, is_symtab)) cnt++;
+  if (0 == cnt) return;
+
+  xdl_addr_entry_t *entries = (xdl_addr_entry_t *)xdl_calloc(&self->allocator, cnt, sizeof(xdl_addr_entry_t));
+  if (NULL == entries) return;
+
+  size_t n = 0;
+  for (size_t i = sym_begin; i < sym_end; i++) {
+    ElfW(Sym) *sym = syms + i;
+    if (!xdl_sym_is_addr_sym(sym, is_symtab)) continue;
+    entries[n].start = sym->st_value;
+    entries[n].idx = i;
+    n++;
+  }
+  qsort(entries, cnt, sizeof(xdl_addr_entry_t), xdl_addr_entry_cmp);
+
+  uintptr_t reach = 0;
+  for (size_t i = 0; i < cnt; i++) {
+    uintptr_t end = entries[i].start + syms[entries[i].idx].st_size;
+    if (reach < end) reach = end;
+    entries[i].reach = reach;
+  }
+
+  index->entries = entries;
+  index->cnt = cnt;
+}
+
+// O(log n): returns the matching symbol with the lowest index, same as a linear scan
+// *cursor: the search starts there, and is left there for the next offset (which must not be lower)
+static ElfW(Sym) *xdl_addr_index_find(xdl_addr_index_t *index, ElfW(Sym) *syms, uintptr_t offset,
+                                      size_t *cursor) {
+  // find the first entry which starts above offset
+  size_t lo = *cursor, hi = index->cnt;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (index->entries[mid].start <= offset)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  *cursor = lo;
+
+  // walk back over the entries which may still cover offset (usually only one)
+  ElfW(Sym) *found = NULL;
+  size_t found_idx = SIZE_MAX;
+  for (size_t i = lo; i > 0 && index->entries[i - 1].reach > offset; i--) {
+    xdl_addr_entry_t *entry = &index->entries[i - 1];
+    ElfW(Sym) *sym = syms + entry->idx;
+    if (offset < entry->start + sym->st_size && entry->idx < found_idx) {
+      found = sym;
+      found_idx = entry->idx;
+    }
+  }
+  return found;
+}
+
+static size_t xdl_dynsym_gnu_hash_sym_end(xdl_t *self) {
+  // the symbols of the last non-empty bucket are at the end of .dynsym
+  uint32_t last = 0;
+  for (size_t i = 0; i < self->gnu_hash.buckets_cnt; i++)
+    if (last < self->gnu_hash.buckets[i]) last = self->gnu_hash.buckets[i];
+  if (last < self->gnu_hash.symoffset) return self->gnu_hash.symoffset;
+
+  const uint32_t *chains_all = self->gnu_hash.chains - self->gnu_hash.symoffset;
+  while ((chains_all[last] & 1) == 0) last++;
+  return (size_t)last + 1;
+}
+
+static void xdl_dynsym_addr_index_init(xdl_t *self) {
+  if (self->gnu_hash.buckets_cnt > 0)
+    xdl_addr_index_build(self, &self->dynsym_addr_index, self->dynsym, self->gnu_hash.symoffset,
+                         xdl_dynsym_gnu_hash_sym_end(self), false);
+  else if (self->sysv_hash.chains_cnt > 0)
+    xdl_addr_index_build(self, &self->dynsym_addr_index, self->dynsym, 0, self->sysv_hash.chains_cnt, false);
+}
+
+static void xdl_symtab_addr_index_init(xdl_t *self) {
+  xdl_addr_index_build(self, &self->symtab_addr_index, self->symtab, 0, self->symtab_cnt, true);
+}
+
+static ElfW(Sym) *xdl_sym_by_addr(void *handle, void *addr, size_t *cursor) {
   xdl_t *self = (xdl_t *)handle;
 
   // load .dynsym only once
-  if (!self->dynsym_try_load) {
-    self->dynsym_try_load = true;
-    if (0 != xdl_dynsym_load(self)) return NULL;
-  }
+  xdl_once(self, &self->dynsym_try_load, xdl_dynsym_init);
 
   // find symbol
   if (NULL == self->dynsym) return NULL;
   uintptr_t offset = (uintptr_t)addr - self->load_bias;
+
+  // build the address index only once
+  xdl_addr_index_t *index = &self->dynsym_addr_index;
+  xdl_once(self, &index->try_build, xdl_dynsym_addr_index_init);
+  if (NULL != index->entries) return xdl_addr_index_find(index, self->dynsym, offset, cursor);
+
+  // fallback: linear scan
   if (self->gnu_hash.buckets_cnt > 0) {
     const uint32_t *chains_all = self->gnu_hash.chains - self->gnu_hash.symoffset;
     for (size_t i = 0; i < self->gnu_hash.buckets_cnt; i++) {
@@ -813,18 +1876,22 @@ static ElfW(Sym) *xdl_sym_by_addr(void *handle, void *addr) {
   return NULL;
 }
 
-static ElfW(Sym) *xdl_dsym_by_addr(void *handle, void *addr) {
+static ElfW(Sym) *xdl_dsym_by_addr(void *handle, void *addr, size_t *cursor) {
   xdl_t *self = (xdl_t *)handle;
 
   // load .symtab only once
-  if (!self->symtab_try_load) {
-    self->symtab_try_load = true;
-    if (0 != xdl_symtab_load(self)) return NULL;
-  }
+  xdl_once(self, &self->symtab_try_load, xdl_symtab_init);
 
   // find symbol
   if (NULL == self->symtab) return NULL;
   uintptr_t offset = (uintptr_t)addr - self->load_bias;
+
+  // build the address index only once
+  xdl_addr_index_t *index = &self->symtab_addr_index;
+  xdl_once(self, &index->try_build, xdl_symtab_addr_index_init);
+  if (NULL != index->entries) return xdl_addr_index_find(index, self->symtab, offset, cursor);
+
+  // fallback: linear scan
   for (size_t i = 0; i < self->symtab_cnt; i++) {
     ElfW(Sym) *sym = self->symtab + i;
     if (xdl_sym_is_match(sym, offset, true)) return sym;
@@ -833,24 +1900,313 @@ static ElfW(Sym) *xdl_dsym_by_addr(void *handle, void *addr) {
   return NULL;
 }
 
-int xdl_addr(void *addr, xdl_info_t *info, void **cache) {
-  if (NULL == addr || NULL == info || NULL == cache) return 0;
+#define XDL_SYM_SCAN_MIN_PER_THREAD 32768
+#define XDL_SYM_SCAN_MAX_THREADS    4
+
+static bool xdl_sym_glob_match(const char *str, const char *pattern) {
+  const char *star = NULL, *star_str = NULL;
+  while ('\0' != *str) {
+    if ('*' == *pattern) {
+      star = pattern++;
+      star_str = str;
+    } else if ('?' == *pattern || *pattern == *str) {
+      pattern++;
+      str++;
+    } else if (NULL != star) {
+      pattern = star + 1;
+      str = ++star_str;
+    } else {
+      return false;
+    }
+  }
+  while ('*' == *pattern) pattern++;
+  return '\0' == *pattern;
+}
 
-  memset(info, 0, sizeof(Dl_info));
+static bool xdl_sym_name_match(const char *name, const char *pattern, size_t pattern_len, int mode) {
+  if (NULL == pattern) return true;
+
+  switch (mode) {
+    case XDL_MATCH_PREFIX:
+      return 0 == strncmp(name, pattern, pattern_len);
+    case XDL_MATCH_SUBSTRING:
+      return NULL != strstr(name, pattern);
+    default:
+      return xdl_sym_glob_match(name, pattern);
+  }
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+
+typedef struct {
+  ElfW(Sym) *syms;
+  const char *strs;
+  size_t strs_sz;
+  bool is_symtab;
+  const char *pattern;
+  size_t pattern_len;
+  int mode;
+  xdl_prefix16_t prefix;  // literal head of the pattern (prefix and glob modes)
+} xdl_sym_table_t;
+
+// one slice of a table, scanned by a worker thread
+typedef struct {
+  xdl_sym_table_t *table;
+  size_t begin;
+  size_t end;
+  size_t *matches;
+  size_t matches_cnt;
+  size_t matches_cap;
+  bool failed;
+} xdl_sym_scan_t;
+
+#pragma clang diagnostic pop
+
+static bool xdl_sym_table_match(xdl_sym_table_t *table, size_t i) {
+  ElfW(Sym) *sym = table->syms + i;
+  if (table->is_symtab) {
+    if (!XDL_SYMTAB_IS_EXPORT_SYM(sym->st_shndx)) return false;
+  } else {
+    if (!XDL_DYNSYM_IS_EXPORT_SYM(sym->st_shndx)) return false;
+  }
+  if (0 == sym->st_name || sym->st_name >= table->strs_sz) return false;
+  // .dynstr has no known size, 16 bytes may run past its mapping
+  if (table->prefix.len > 0 && SIZE_MAX != table->strs_sz && table->strs_sz - sym->st_name >= 16 &&
+      !xdl_prefix16_may_match(&table->prefix, table->strs + sym->st_name))
+    return false;
+
+  return xdl_sym_name_match(table->strs + sym->st_name, table->pattern, table->pattern_len, table->mode);
+}
+
+static void *xdl_sym_scan_worker(void *arg) {
+  xdl_sym_scan_t *scan = (xdl_sym_scan_t *)arg;
+
+  for (size_t i = scan->begin; i < scan->end; i++) {
+    if (!xdl_sym_table_match(scan->table, i)) continue;
+
+    if (scan->matches_cnt == scan->matches_cap) {
+      size_t cap = scan->matches_cap > 0 ? scan->matches_cap * 2 : 64;
+      size_t *matches = (size_t *)realloc(scan->matches, cap * sizeof(size_t));
+      if (NULL == matches) {
+        scan->failed = true;
+        break;
+      }
+      scan->matches = matches;
+      scan->matches_cap = cap;
+    }
+    scan->matches[scan->matches_cnt++] = i;
+  }
+  return NULL;
+}
+
+static int xdl_sym_enum_callback(xdl_t *self, xdl_sym_table_t *table, size_t i, xdl_sym_iterate_cb_t cb,
+                                 void *arg) {
+  ElfW(Sym) *sym = table->syms + i;
+
+  xdl_sym_info_t info;
+  info.name = table->strs + sym->st_name;
+  info.addr = (void *)(self->load_bias + sym->st_value);
+  info.size = sym->st_size;
+  info.type = ELF_ST_TYPE(sym->st_info);
+  info.bind = ELF_ST_BIND(sym->st_info);
+  info.is_symtab = table->is_symtab;
+  return cb(&info, arg);
+}
+
+// split a pattern query over a large table across threads, callbacks still run here and in order
+static int xdl_sym_enum_table_parallel(xdl_t *self, xdl_sym_table_t *table, size_t begin, size_t end,
+                                       size_t threads_cnt, xdl_sym_iterate_cb_t cb, void *arg) {
+  xdl_sym_scan_t scans[XDL_SYM_SCAN_MAX_THREADS];
+  pthread_t threads[XDL_SYM_SCAN_MAX_THREADS];
+  bool started[XDL_SYM_SCAN_MAX_THREADS];
+  size_t slice = (end - begin + threads_cnt - 1) / threads_cnt;
+
+  memset(scans, 0, sizeof(scans));
+  for (size_t t = 0; t < threads_cnt; t++) {
+    scans[t].table = table;
+    scans[t].begin = begin + t * slice;
+    scans[t].end = (t + 1 == threads_cnt ? end : begin + (t + 1) * slice);
+    started[t] = (t > 0 && 0 == pthread_create(&threads[t], NULL, xdl_sym_scan_worker, &scans[t]));
+  }
+  for (size_t t = 0; t < threads_cnt; t++)
+    if (!started[t]) xdl_sym_scan_worker(&scans[t]);
+  for (size_t t = 1; t < threads_cnt; t++)
+    if (started[t]) pthread_join(threads[t], NULL);
+
+  int r = 0;
+  for (size_t t = 0; t < threads_cnt; t++) {
+    if (scans[t].failed) r = -1;
+    for (size_t i = 0; 0 == r && i < scans[t].matches_cnt; i++)
+      r = xdl_sym_enum_callback(self, table, scans[t].matches[i], cb, arg);
+    free(scans[t].matches);
+  }
+  return r;
+}
+
+static int xdl_sym_enum_table(xdl_t *self, xdl_sym_table_t *table, size_t begin, size_t end,
+                              xdl_sym_iterate_cb_t cb, void *arg) {
+  // only matching is worth spreading, plain enumeration is bound by the callback
+  if (NULL != table->pattern) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads_cnt = (end - begin) / XDL_SYM_SCAN_MIN_PER_THREAD;
+    if (threads_cnt > XDL_SYM_SCAN_MAX_THREADS) threads_cnt = XDL_SYM_SCAN_MAX_THREADS;
+    if (cpus > 0 && threads_cnt > (size_t)cpus) threads_cnt = (size_t)cpus;
+    if (threads_cnt > 1) return xdl_sym_enum_table_parallel(self, table, begin, end, threads_cnt, cb, arg);
+  }
+
+  for (size_t i = begin; i < end; i++) {
+    if (!xdl_sym_table_match(table, i)) continue;
+
+    int r = xdl_sym_enum_callback(self, table, i, cb, arg);
+    if (0 != r) return r;
+  }
+  return 0;
+}
+
+static int xdl_sym_enum(xdl_t *self, const char *pattern, int flags, xdl_sym_iterate_cb_t cb, void *arg) {
+  if (0 == (flags & (XDL_ITERATE_DYNSYM | XDL_ITERATE_SYMTAB))) flags |= XDL_ITERATE_DYNSYM | XDL_ITERATE_SYMTAB;
+
+  xdl_sym_table_t table;
+  table.pattern = pattern;
+  table.pattern_len = (NULL == pattern ? 0 : strlen(pattern));
+  table.mode = flags & (XDL_MATCH_PREFIX | XDL_MATCH_SUBSTRING);
+  if (NULL == pattern || XDL_MATCH_SUBSTRING == table.mode)
+    xdl_prefix16_init(&table.prefix, NULL, 0);
+  else if (XDL_MATCH_PREFIX == table.mode)
+    xdl_prefix16_init(&table.prefix, pattern, table.pattern_len);
+  else
+    xdl_prefix16_init(&table.prefix, pattern, strcspn(pattern, "*?"));
+  int r;
+
+  if (flags & XDL_ITERATE_DYNSYM) {
+    xdl_once(self, &self->dynsym_try_load, xdl_dynsym_init);
+    if (NULL != self->dynsym) {
+      size_t end = 0;
+      if (self->gnu_hash.buckets_cnt > 0)
+        end = xdl_dynsym_gnu_hash_sym_end(self);
+      else if (self->sysv_hash.chains_cnt > 0)
+        end = self->sysv_hash.chains_cnt;
+
+      table.syms = self->dynsym;
+      table.strs = self->dynstr;
+      table.strs_sz = self->dynstr_sz;
+      table.is_symtab = false;
+      if (0 != (r = xdl_sym_enum_table(self, &table, 0, end, cb, arg))) return r;
+    }
+  }
+
+  if (flags & XDL_ITERATE_SYMTAB) {
+    xdl_once(self, &self->symtab_try_load, xdl_symtab_init);
+    if (NULL != self->symtab) {
+      table.syms = self->symtab;
+      table.strs = self->strtab;
+      table.strs_sz = self->strtab_sz;
+      table.is_symtab = true;
+      if (0 != (r = xdl_sym_enum_table(self, &table, 0, self->symtab_cnt, cb, arg))) return r;
+    }
+  }
+
+  return 0;
+}
+
+int xdl_sym_iterate(void *handle, int flags, xdl_sym_iterate_cb_t cb, void *arg) {
+  if (NULL == handle || NULL == cb) return -1;
+
+  return xdl_sym_enum((xdl_t *)handle, NULL, flags, cb, arg);
+}
+
+int xdl_sym_query(void *handle, const char *pattern, int flags, xdl_sym_iterate_cb_t cb, void *arg) {
+  if (NULL == handle || NULL == pattern || NULL == cb) return -1;
+
+  return xdl_sym_enum((xdl_t *)handle, pattern, flags, cb, arg);
+}
+
+// PT_LOAD segments of the ELFs in the cache, sorted by address
+static xdl_t *xdl_addr_cache_find(xdl_addr_cache_t *cache, uintptr_t addr) {
+  // fast path: addresses being symbolized are usually clustered
+  if (cache->last < cache->ranges_cnt) {
+    xdl_addr_range_t *range = &cache->ranges[cache->last];
+    if (range->start <= addr && addr < range->end) return range->handle;
+  }
+
+  // find the last range which starts at or below addr
+  size_t lo = 0, hi = cache->ranges_cnt;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (cache->ranges[mid].start <= addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (0 == lo || addr >= cache->ranges[lo - 1].end) return NULL;
+
+  cache->last = lo - 1;
+  return cache->ranges[lo - 1].handle;
+}
+
+static int xdl_addr_cache_add(xdl_addr_cache_t *cache, xdl_t *handle) {
+  size_t cnt = 0;
+  for (size_t i = 0; i < handle->dlpi_phnum; i++)
+    if (PT_LOAD == handle->dlpi_phdr[i].p_type) cnt++;
+
+  if (cache->ranges_cnt + cnt > cache->ranges_cap) {
+    size_t cap = cache->ranges_cap > 0 ? cache->ranges_cap * 2 : 64;
+    while (cap < cache->ranges_cnt + cnt) cap *= 2;
+    xdl_addr_range_t *ranges = (xdl_addr_range_t *)realloc(cache->ranges, cap * sizeof(xdl_addr_range_t));
+    if (NULL == ranges) return -1;
+    cache->ranges = ranges;
+    cache->ranges_cap = cap;
+  }
+
+  for (size_t i = 0; i < handle->dlpi_phnum; i++) {
+    const ElfW(Phdr) *phdr = &(handle->dlpi_phdr[i]);
+    if (PT_LOAD != phdr->p_type) continue;
+
+    uintptr_t start = handle->load_bias + phdr->p_vaddr;
+    size_t pos = cache->ranges_cnt;
+    while (pos > 0 && cache->ranges[pos - 1].start > start) pos--;
+    memmove(&cache->ranges[pos + 1], &cache->ranges[pos], (cache->ranges_cnt - pos) * sizeof(xdl_addr_range_t));
+    cache->ranges[pos].start = start;
+    cache->ranges[pos].end = start + phdr->p_memsz;
+    cache->ranges[pos].handle = handle;
+    cache->ranges_cnt++;
+  }
+
+  // the handles are owned by the list
+  handle->next = cache->handles;
+  cache->handles = handle;
+  return 0;
+}
+
+static xdl_addr_cache_t *xdl_addr_cache_get(void **cache) {
+  // create the cache on first use
+  xdl_addr_cache_t *addr_cache = *(xdl_addr_cache_t **)cache;
+  if (NULL == addr_cache) {
+    if (NULL == (addr_cache = calloc(1, sizeof(xdl_addr_cache_t)))) return NULL;
+    *(xdl_addr_cache_t **)cache = addr_cache;
+  }
+  return addr_cache;
+}
 
-  // find handle from cache
-  xdl_t *handle = NULL;
-  for (handle = *((xdl_t **)cache); NULL != handle; handle = handle->next)
-    if (xdl_elf_is_match(handle->load_bias, handle->dlpi_phdr, handle->dlpi_phnum, (uintptr_t)addr)) break;
+static xdl_t *xdl_addr_cache_get_handle(xdl_addr_cache_t *addr_cache, void *addr) {
+  // find handle from cache, O(log n)
+  xdl_t *handle = xdl_addr_cache_find(addr_cache, (uintptr_t)addr);
 
   // create new handle, save handle to cache
   if (NULL == handle) {
     handle = (xdl_t *)xdl_open_by_addr(addr);
-    if (NULL == handle) return 0;
-    handle->next = *(xdl_t **)cache;
-    *(xdl_t **)cache = handle;
+    if (NULL == handle) return NULL;
+    if (0 != xdl_addr_cache_add(addr_cache, handle)) {
+      xdl_close(handle);
+      return NULL;
+    }
   }
+  return handle;
+}
 
+// cursors: one for .dynsym and one for .symtab, see xdl_addr_index_find()
+static void xdl_addr_fill_info(xdl_t *handle, void *addr, xdl_info_t *info, size_t cursors[2]) {
   // we have at least: load_bias, pathname, dlpi_phdr, dlpi_phnum
   info->dli_fbase = (void *)handle->load_bias;
   info->dli_fname = handle->pathname;
@@ -862,31 +2218,152 @@ int xdl_addr(void *addr, xdl_info_t *info, void **cache) {
 
   // keep looking for: symbol name, symbol offset, symbol size
   ElfW(Sym) *sym;
-  if (NULL != (sym = xdl_sym_by_addr((void *)handle, addr))) {
+  if (NULL != (sym = xdl_sym_by_addr((void *)handle, addr, &cursors[0]))) {
     info->dli_sname = handle->dynstr + sym->st_name;
     info->dli_saddr = (void *)(handle->load_bias + sym->st_value);
     info->dli_ssize = sym->st_size;
-  } else if (NULL != (sym = xdl_dsym_by_addr((void *)handle, addr))) {
+  } else if (NULL != (sym = xdl_dsym_by_addr((void *)handle, addr, &cursors[1]))) {
     info->dli_sname = handle->strtab + sym->st_name;
     info->dli_saddr = (void *)(handle->load_bias + sym->st_value);
     info->dli_ssize = sym->st_size;
   }
+}
+
+int xdl_addr(void *addr, xdl_info_t *info, void **cache) {
+  if (NULL == addr || NULL == info || NULL == cache) return 0;
 
+  memset(info, 0, sizeof(Dl_info));
+
+  xdl_addr_cache_t *addr_cache = xdl_addr_cache_get(cache);
+  if (NULL == addr_cache) return 0;
+  xdl_t *handle = xdl_addr_cache_get_handle(addr_cache, addr);
+  if (NULL == handle) return 0;
+
+  size_t cursors[2] = {0, 0};
+  xdl_addr_fill_info(handle, addr, info, cursors);
   return 1;
 }
 
+typedef struct {
+  uintptr_t addr;
+  size_t idx;
+} xdl_addr_batch_item_t;
+
+static int xdl_addr_batch_item_cmp(const void *a, const void *b) {
+  uintptr_t aa = ((const xdl_addr_batch_item_t *)a)->addr, ab = ((const xdl_addr_batch_item_t *)b)->addr;
+  return aa < ab ? -1 : (aa > ab ? 1 : 0);
+}
+
+#define XDL_ADDR_BATCH_STACK_ITEMS 64
+
+int xdl_addr_batch(void **addrs, size_t n, xdl_info_t *infos, void **cache) {
+  if (NULL == addrs || NULL == infos || NULL == cache) return -1;
+
+  xdl_addr_cache_t *addr_cache = xdl_addr_cache_get(cache);
+  if (NULL == addr_cache) return -1;
+
+  // sort by address, so that the addresses of each ELF come together and in order
+  xdl_addr_batch_item_t stack_items[XDL_ADDR_BATCH_STACK_ITEMS];
+  xdl_addr_batch_item_t *items = stack_items;
+  if (n > XDL_ADDR_BATCH_STACK_ITEMS) {
+    if (NULL == (items = (xdl_addr_batch_item_t *)malloc(n * sizeof(xdl_addr_batch_item_t)))) return -1;
+  }
+  size_t items_cnt = 0;
+  for (size_t i = 0; i < n; i++) {
+    memset(&infos[i], 0, sizeof(xdl_info_t));
+    if (NULL == addrs[i]) continue;
+    items[items_cnt].addr = (uintptr_t)addrs[i];
+    items[items_cnt].idx = i;
+    items_cnt++;
+  }
+  if (items_cnt > XDL_ADDR_BATCH_STACK_ITEMS) {
+    qsort(items, items_cnt, sizeof(xdl_addr_batch_item_t), xdl_addr_batch_item_cmp);
+  } else {
+    // insertion sort, cheaper than qsort() for a backtrace
+    for (size_t i = 1; i < items_cnt; i++) {
+      xdl_addr_batch_item_t item = items[i];
+      size_t j = i;
+      for (; j > 0 && items[j - 1].addr > item.addr; j--) items[j] = items[j - 1];
+      items[j] = item;
+    }
+  }
+
+  // one merge pass over the address index of each ELF: the cursors only move forward
+  int found = 0;
+  xdl_t *group = NULL;
+  size_t cursors[2] = {0, 0};
+  for (size_t i = 0; i < items_cnt; i++) {
+    // repeated frames (e.g. recursion), a miss is not looked up again either
+    if (i > 0 && items[i].addr == items[i - 1].addr) {
+      infos[items[i].idx] = infos[items[i - 1].idx];
+      if (NULL != infos[items[i].idx].dli_fname) found++;
+      continue;
+    }
+
+    void *addr = (void *)items[i].addr;
+    xdl_t *handle = xdl_addr_cache_get_handle(addr_cache, addr);
+    if (NULL == handle) continue;
+    if (handle != group) {
+      group = handle;
+      cursors[0] = cursors[1] = 0;
+    }
+
+    xdl_addr_fill_info(handle, addr, &infos[items[i].idx], cursors);
+    found++;
+  }
+
+  if (items != stack_items) free(items);
+  return found;
+}
+
 void xdl_addr_clean(void **cache) {
-  if (NULL == cache) return;
+  if (NULL == cache || NULL == *cache) return;
 
-  xdl_t *handle = *((xdl_t **)cache);
+  xdl_addr_cache_t *addr_cache = *(xdl_addr_cache_t **)cache;
+  xdl_t *handle = addr_cache->handles;
   while (NULL != handle) {
     xdl_t *tmp = handle;
     handle = handle->next;
     xdl_close(tmp);
   }
+  free(addr_cache->ranges);
+  free(addr_cache);
   *cache = NULL;
 }
 
+void xdl_set_allocator(const xdl_allocator_t *allocator) {
+  if (NULL == allocator)
+    memset(&xdl_thread_allocator, 0, sizeof(xdl_thread_allocator));
+  else
+    xdl_thread_allocator = *allocator;
+}
+
+int xdl_arena_create(size_t chunk_size, xdl_allocator_t *allocator) {
+  if (NULL == allocator) return -1;
+
+  xdl_arena_t *arena = xdl_arena_new(chunk_size);
+  if (NULL == arena) return -1;
+  allocator->alloc = xdl_arena_alloc;
+  allocator->free = NULL;
+  allocator->ctx = arena;
+  return 0;
+}
+
+void xdl_arena_destroy(xdl_allocator_t *allocator) {
+  if (NULL == allocator || xdl_arena_alloc != allocator->alloc) return;
+
+  xdl_arena_release((xdl_arena_t *)allocator->ctx);
+  memset(allocator, 0, sizeof(xdl_allocator_t));
+}
+
+int xdl_set_symoff_file(const char *pathname) {
+  return xdl_symoff_set_file(pathname);
+}
+
+int xdl_set_symcache_file(const char *pathname) {
+  return xdl_symcache_set_file(pathname);
+}
+
 int xdl_iterate_phdr(int (*callback)(struct dl_phdr_info *, size_t, void *), void *data, int flags) {
   if (NULL == callback) return 0;
 
@@ -0,0 +1,122 @@
+// Copyright (c) 2020-2023 HexHacking Team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "xdl_arena.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define XDL_ARENA_CHUNK_SZ_DEFAULT (64 * 1024)
+#define XDL_ARENA_ALIGN            16
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+
+typedef struct xdl_arena_chunk {
+  struct xdl_arena_chunk *next;
+  size_t sz;  // of the whole mapping
+} xdl_arena_chunk_t;
+
+struct xdl_arena {
+  pthread_mutex_t lock;
+  size_t chunk_sz;
+  xdl_arena_chunk_t *chunks;
+  uintptr_t cur;  // free space of the current chunk
+  uintptr_t end;
+};
+
+#pragma clang diagnostic pop
+
+#define XDL_ARENA_CHUNK_HDR_SZ ((sizeof(xdl_arena_chunk_t) + XDL_ARENA_ALIGN - 1) & ~(size_t)(XDL_ARENA_ALIGN - 1))
+
+static xdl_arena_chunk_t *xdl_arena_map_chunk(xdl_arena_t *arena, size_t sz) {
+  void *map = mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == map) return NULL;
+
+  xdl_arena_chunk_t *chunk = (xdl_arena_chunk_t *)map;
+  chunk->sz = sz;
+  chunk->next = arena->chunks;
+  arena->chunks = chunk;
+  return chunk;
+}
+
+xdl_arena_t *xdl_arena_new(size_t chunk_sz) {
+  size_t page_sz = (size_t)getpagesize();
+  if (0 == chunk_sz) chunk_sz = XDL_ARENA_CHUNK_SZ_DEFAULT;
+  chunk_sz = (chunk_sz + page_sz - 1) & ~(page_sz - 1);
+  if (chunk_sz < XDL_ARENA_CHUNK_HDR_SZ + sizeof(xdl_arena_t)) return NULL;
+
+  // the arena itself lives at the start of its first chunk
+  xdl_arena_t tmp = {.chunk_sz = chunk_sz, .chunks = NULL, .cur = 0, .end = 0};
+  xdl_arena_chunk_t *chunk = xdl_arena_map_chunk(&tmp, chunk_sz);
+  if (NULL == chunk) return NULL;
+
+  xdl_arena_t *arena = (xdl_arena_t *)((uintptr_t)chunk + XDL_ARENA_CHUNK_HDR_SZ);
+  *arena = tmp;
+  pthread_mutex_init(&arena->lock, NULL);
+  arena->cur = ((uintptr_t)(arena + 1) + XDL_ARENA_ALIGN - 1) & ~(uintptr_t)(XDL_ARENA_ALIGN - 1);
+  arena->end = (uintptr_t)chunk + chunk_sz;
+  return arena;
+}
+
+void xdl_arena_release(xdl_arena_t *arena) {
+  if (NULL == arena) return;
+
+  pthread_mutex_destroy(&arena->lock);
+  xdl_arena_chunk_t *chunk = arena->chunks;
+  while (NULL != chunk) {
+    xdl_arena_chunk_t *next = chunk->next;
+    munmap(chunk, chunk->sz);  // the last one holds the arena
+    chunk = next;
+  }
+}
+
+void *xdl_arena_alloc(void *ctx, size_t size) {
+  xdl_arena_t *arena = (xdl_arena_t *)ctx;
+  if (size > SIZE_MAX - XDL_ARENA_CHUNK_HDR_SZ - arena->chunk_sz) return NULL;
+  size = (0 == size ? XDL_ARENA_ALIGN : (size + XDL_ARENA_ALIGN - 1) & ~(size_t)(XDL_ARENA_ALIGN - 1));
+
+  void *ptr = NULL;
+  pthread_mutex_lock(&arena->lock);
+  if (size <= arena->end - arena->cur) {
+    ptr = (void *)arena->cur;
+    arena->cur += size;
+  } else if (XDL_ARENA_CHUNK_HDR_SZ + size > arena->chunk_sz / 4) {
+    // large allocations get their own chunk, the current one keeps its free space
+    size_t page_sz = (size_t)getpagesize();
+    size_t sz = (XDL_ARENA_CHUNK_HDR_SZ + size + page_sz - 1) & ~(page_sz - 1);
+    xdl_arena_chunk_t *chunk = xdl_arena_map_chunk(arena, sz);
+    if (NULL != chunk) ptr = (void *)((uintptr_t)chunk + XDL_ARENA_CHUNK_HDR_SZ);
+  } else {
+    xdl_arena_chunk_t *chunk = xdl_arena_map_chunk(arena, arena->chunk_sz);
+    if (NULL != chunk) {
+      ptr = (void *)((uintptr_t)chunk + XDL_ARENA_CHUNK_HDR_SZ);
+      arena->cur = (uintptr_t)ptr + size;
+      arena->end = (uintptr_t)chunk + arena->chunk_sz;
+    }
+  }
+  pthread_mutex_unlock(&arena->lock);
+  return ptr;
+}
@@ -23,14 +23,12 @@
 
 #include "xdl_iterate.h"
 
-#include <android/api-level.h>
-#include <ctype.h>
 #include <dlfcn.h>
 #include <elf.h>
-#include <inttypes.h>
 #include <link.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -38,6 +36,7 @@
 
 #include "xdl.h"
 #include "xdl_linker.h"
+#include "xdl_maps.h"
 #include "xdl_util.h"
 
 /*
@@ -71,46 +70,30 @@ static uintptr_t xdl_iterate_get_min_vaddr(struct dl_phdr_info *info) {
   return min_vaddr;
 }
 
-static int xdl_iterate_open_or_rewind_maps(FILE **maps) {
-  if (NULL == *maps) {
-    *maps = fopen("/proc/self/maps", "r");
-    if (NULL == *maps) return -1;
-  } else
-    rewind(*maps);
+// /proc/self/maps is only read when the first ELF needs its full pathname, then shared by the rest
+typedef struct {
+  int status;  // 0: not loaded, 1: loaded, -1: failed
+  xdl_maps_t snapshot;
+} xdl_iterate_maps_t;
 
-  return 0;
-}
+static int xdl_iterate_get_pathname_from_maps(uintptr_t base, char *buf, size_t buf_len,
+                                              xdl_iterate_maps_t *maps) {
+  if (0 == maps->status) maps->status = (0 == xdl_maps_load(&maps->snapshot, NULL) ? 1 : -1);
+  if (1 != maps->status) return -1;  // failed
 
-static int xdl_iterate_get_pathname_from_maps(uintptr_t base, char *buf, size_t buf_len, FILE **maps) {
-  // open or rewind maps-file
-  if (0 != xdl_iterate_open_or_rewind_maps(maps)) return -1;  // failed
-
-  char line[1024];
-  while (fgets(line, sizeof(line), *maps)) {
-    // check base address
-    uintptr_t start, end;
-    if (2 != sscanf(line, "%" SCNxPTR "-%" SCNxPTR " r", &start, &end)) continue;
-    if (base < start) break;  // failed
-    if (base >= end) continue;
-
-    // get pathname
-    char *pathname = strchr(line, '/');
-    if (NULL == pathname) break;  // failed
-    xdl_util_trim_ending(pathname);
-
-    // found it
-    strlcpy(buf, pathname, buf_len);
-    return 0;  // OK
-  }
+  const xdl_maps_entry_t *entry = xdl_maps_find(&maps->snapshot, base);
+  if (NULL == entry || '/' != entry->pathname[0]) return -1;  // failed
 
-  return -1;  // failed
+  // found it
+  snprintf(buf, buf_len, "%s", entry->pathname);
+  return 0;  // OK
 }
 
 static int xdl_iterate_by_linker_cb(struct dl_phdr_info *info, size_t size, void *arg) {
   uintptr_t *pkg = (uintptr_t *)arg;
   xdl_iterate_phdr_cb_t cb = (xdl_iterate_phdr_cb_t)*pkg++;
   void *cb_arg = (void *)*pkg++;
-  FILE **maps = (FILE **)*pkg++;
+  xdl_iterate_maps_t *maps = (xdl_iterate_maps_t *)*pkg++;
   uintptr_t linker_load_bias = *pkg++;
   int flags = (int)*pkg;
 
@@ -151,6 +134,7 @@ static int xdl_iterate_by_linker_cb(struct dl_phdr_info *info, size_t size, void
   return cb(info, size, cb_arg);
 }
 
+#ifdef __ANDROID__
 static uintptr_t xdl_iterate_get_linker_base(void) {
   if (NULL == getauxval) return 0;
 
@@ -178,23 +162,26 @@ static int xdl_iterate_do_callback(xdl_iterate_phdr_cb_t cb, void *cb_arg, uintp
 
   return cb(&info, sizeof(struct dl_phdr_info), cb_arg);
 }
+#endif
 
 static int xdl_iterate_by_linker(xdl_iterate_phdr_cb_t cb, void *cb_arg, int flags) {
   if (NULL == dl_iterate_phdr) return 0;
 
   int api_level = xdl_util_get_api_level();
-  FILE *maps = NULL;
+  xdl_iterate_maps_t maps = {0};
   int r;
 
   // dl_iterate_phdr(3) does NOT contain linker/linker64 when Android version < 8.1 (API level 27).
   // Here we always try to get linker base address from auxv.
   uintptr_t linker_load_bias = 0;
+#ifdef __ANDROID__
   uintptr_t linker_base = xdl_iterate_get_linker_base();
   if (0 != linker_base) {
     if (0 !=
         (r = xdl_iterate_do_callback(cb, cb_arg, linker_base, XDL_UTIL_LINKER_PATHNAME, &linker_load_bias)))
       return r;
   }
+#endif
 
   // for other ELF
   uintptr_t pkg[5] = {(uintptr_t)cb, (uintptr_t)cb_arg, (uintptr_t)&maps, linker_load_bias, (uintptr_t)flags};
@@ -202,79 +189,54 @@ static int xdl_iterate_by_linker(xdl_iterate_phdr_cb_t cb, void *cb_arg, int fla
   r = dl_iterate_phdr(xdl_iterate_by_linker_cb, pkg);
   if (__ANDROID_API_L__ == api_level || __ANDROID_API_L_MR1__ == api_level) xdl_linker_unlock();
 
-  if (NULL != maps) fclose(maps);
+  if (1 == maps.status) xdl_maps_free(&maps.snapshot);
   return r;
 }
 
 #if (defined(__arm__) || defined(__i386__)) && __ANDROID_API__ < __ANDROID_API_L__
 static int xdl_iterate_by_maps(xdl_iterate_phdr_cb_t cb, void *cb_arg) {
-  FILE *maps = fopen("/proc/self/maps", "r");
-  if (NULL == maps) return 0;
+  xdl_maps_t maps;
+  if (0 != xdl_maps_load(&maps, NULL)) return 0;
 
   int r = 0;
-  char buf1[1024], buf2[1024];
-  char *line = buf1;
-  uintptr_t prev_base = 0;
-  bool try_next_line = false;
+  const xdl_maps_entry_t *prev = NULL;
 
-  while (fgets(line, sizeof(buf1), maps)) {
+  for (size_t i = 0; i < maps.entries_cnt; i++) {
     // Try to find an ELF which loaded by linker.
-    uintptr_t base, offset;
-    char exec;
-    if (3 != sscanf(line, "%" SCNxPTR "-%*" SCNxPTR " r%*c%cp %" SCNxPTR " ", &base, &exec, &offset))
-      goto clean;
+    const xdl_maps_entry_t *entry = &maps.entries[i];
+    const xdl_maps_entry_t *prev_entry = prev;
+    prev = NULL;
+    if (!entry->readable || !entry->is_private) continue;
 
-    if ('-' == exec && 0 == offset) {
+    if (!entry->executable && 0 == entry->offset) {
       // r--p
-      prev_base = base;
-      line = (line == buf1 ? buf2 : buf1);
-      try_next_line = true;
+      prev = entry;
       continue;
-    } else if (exec == 'x') {
+    } else if (entry->executable) {
       // r-xp
-      char *pathname = NULL;
-      if (try_next_line && 0 != offset) {
-        char *prev = (line == buf1 ? buf2 : buf1);
-        char *prev_pathname = strchr(prev, '/');
-        if (NULL == prev_pathname) goto clean;
+      uintptr_t base = entry->start;
+      uintptr_t offset = entry->offset;
+      const char *pathname = entry->pathname;
+      if ('/' != pathname[0]) continue;
 
-        pathname = strchr(line, '/');
-        if (NULL == pathname) goto clean;
-
-        xdl_util_trim_ending(prev_pathname);
-        xdl_util_trim_ending(pathname);
-        if (0 != strcmp(prev_pathname, pathname)) goto clean;
+      if (NULL != prev_entry && 0 != offset) {
+        if (0 != strcmp(prev_entry->pathname, pathname)) continue;
 
         // we found the line with r-xp in the next line
-        base = prev_base;
+        base = prev_entry->start;
         offset = 0;
       }
 
-      if (0 != offset) goto clean;
-
-      // get pathname
-      if (NULL == pathname) {
-        pathname = strchr(line, '/');
-        if (NULL == pathname) goto clean;
-        xdl_util_trim_ending(pathname);
-      }
+      if (0 != offset) continue;
 
-      if (0 != memcmp((void *)base, ELFMAG, SELFMAG)) goto clean;
-      ElfW(Ehdr) *ehdr = (ElfW(Ehdr) *)base;
-      struct dl_phdr_info info;
-      info.dlpi_name = pathname;
-      info.dlpi_phdr = (const ElfW(Phdr) *)(base + ehdr->e_phoff);
-      info.dlpi_phnum = ehdr->e_phnum;
+      if (0 != memcmp((void *)base, ELFMAG, SELFMAG)) continue;
 
       // callback
       if (0 != (r = xdl_iterate_do_callback(cb, cb_arg, base, pathname, NULL))) break;
     }
-
-  clean:
-    try_next_line = false;
   }
 
-  fclose(maps);
+  xdl_maps_free(&maps);
   return r;
 }
 #endif
@@ -289,9 +251,37 @@ int xdl_iterate_phdr_impl(xdl_iterate_phdr_cb_t cb, void *cb_arg, int flags) {
   return xdl_iterate_by_linker(cb, cb_arg, flags);
 }
 
+static int xdl_iterate_get_counters_cb(struct dl_phdr_info *info, size_t size, void *arg) {
+  unsigned long long *counters = (unsigned long long *)arg;
+  if (size < offsetof(struct dl_phdr_info, dlpi_subs) + sizeof(info->dlpi_subs)) return -1;  // API level < 30
+
+  counters[0] = info->dlpi_adds;
+  counters[1] = info->dlpi_subs;
+  return 1;  // the counters are the same in every entry, stop here
+}
+
+int xdl_iterate_get_counters(unsigned long long *adds, unsigned long long *subs) {
+  if (NULL == dl_iterate_phdr) return -1;
+
+  unsigned long long counters[2];
+  if (1 != dl_iterate_phdr(xdl_iterate_get_counters_cb, counters)) return -1;
+
+  *adds = counters[0];
+  *subs = counters[1];
+  return 0;
+}
+
 int xdl_iterate_get_full_pathname(uintptr_t base, char *buf, size_t buf_len) {
-  FILE *maps = NULL;
-  int r = xdl_iterate_get_pathname_from_maps(base, buf, buf_len, &maps);
-  if (NULL != maps) fclose(maps);
+  xdl_maps_t maps;
+  if (0 != xdl_maps_load(&maps, NULL)) return -1;
+
+  int r = -1;
+  const xdl_maps_entry_t *entry = xdl_maps_find(&maps, base);
+  if (NULL != entry && '/' == entry->pathname[0]) {
+    snprintf(buf, buf_len, "%s", entry->pathname);
+    r = 0;
+  }
+
+  xdl_maps_free(&maps);
   return r;
 }
@@ -36,6 +36,9 @@ int xdl_iterate_phdr_impl(xdl_iterate_phdr_cb_t cb, void *cb_arg, int flags);
 
 int xdl_iterate_get_full_pathname(uintptr_t base, char *buf, size_t buf_len);
 
+// dlpi_adds & dlpi_subs of dl_iterate_phdr(), -1 when not supported (API level < 30)
+int xdl_iterate_get_counters(unsigned long long *adds, unsigned long long *subs);
+
 #ifdef __cplusplus
 }
 #endif
@@ -25,6 +25,7 @@
 
 #include <dlfcn.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 
@@ -90,12 +91,12 @@ static void xdl_linker_init_symbols_impl(void) {
 
 static void xdl_linker_init_symbols(void) {
   static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
-  static bool inited = false;
-  if (!inited) {
+  static atomic_bool inited = false;
+  if (!atomic_load_explicit(&inited, memory_order_acquire)) {
     pthread_mutex_lock(&lock);
-    if (!inited) {
+    if (!atomic_load_explicit(&inited, memory_order_relaxed)) {
       xdl_linker_init_symbols_impl();
-      inited = true;
+      atomic_store_explicit(&inited, true, memory_order_release);
     }
     pthread_mutex_unlock(&lock);
   }
@@ -160,18 +161,22 @@ static void xdl_linker_init_caller_addr_impl(void) {
 
 static void xdl_linker_init_caller_addr(void) {
   static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
-  static bool inited = false;
-  if (!inited) {
+  static atomic_bool inited = false;
+  if (!atomic_load_explicit(&inited, memory_order_acquire)) {
     pthread_mutex_lock(&lock);
-    if (!inited) {
+    if (!atomic_load_explicit(&inited, memory_order_relaxed)) {
       xdl_linker_init_caller_addr_impl();
-      inited = true;
+      atomic_store_explicit(&inited, true, memory_order_release);
     }
     pthread_mutex_unlock(&lock);
   }
 }
 
 void *xdl_linker_force_dlopen(const char *filename) {
+#ifndef __ANDROID__
+  // host: no linker namespaces to get around
+  return dlopen(filename, RTLD_NOW);
+#endif
   int api_level = xdl_util_get_api_level();
 
   if (api_level <= __ANDROID_API_M__) {
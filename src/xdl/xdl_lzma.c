@@ -26,6 +26,7 @@
 #include <ctype.h>
 #include <inttypes.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -117,7 +118,81 @@ static void xdl_lzma_internal_free(ISzAllocPtr p, void *address) {
   free(address);
 }
 
-int xdl_lzma_decompress(uint8_t *src, size_t src_size, uint8_t **dst, size_t *dst_size) {
+static int xdl_lzma_init_once(void) {
+  static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  static atomic_bool inited = false;
+  if (!atomic_load_explicit(&inited, memory_order_acquire)) {
+    pthread_mutex_lock(&lock);
+    if (!atomic_load_explicit(&inited, memory_order_relaxed)) {
+      xdl_lzma_init();
+      atomic_store_explicit(&inited, true, memory_order_release);
+    }
+    pthread_mutex_unlock(&lock);
+  }
+  return NULL == xdl_lzma_code ? -1 : 0;
+}
+
+static int xdl_lzma_code_step(void *state, uint8_t *dst, size_t *dst_len, const uint8_t *src, size_t *src_len,
+                              ECoderStatus *status, int api_level) {
+  if (api_level >= __ANDROID_API_Q__) {
+    xdl_lzma_code_q_t lzma_code_q = (xdl_lzma_code_q_t)xdl_lzma_code;
+    return lzma_code_q(state, dst, dst_len, src, src_len, 1, CODER_FINISH_ANY, status);
+  } else {
+    xdl_lzma_code_t lzma_code = (xdl_lzma_code_t)xdl_lzma_code;
+    return lzma_code(state, dst, dst_len, src, src_len, CODER_FINISH_ANY, status);
+  }
+}
+
+#define XDL_LZMA_XZ_HEADER_SIZE 12
+#define XDL_LZMA_XZ_FOOTER_SIZE 12
+
+static int xdl_lzma_read_varint(const uint8_t **p, const uint8_t *end, uint64_t *val) {
+  uint64_t v = 0;
+  for (size_t i = 0; i < 9 && *p < end; i++) {
+    uint8_t b = *(*p)++;
+    v |= (uint64_t)(b & 0x7F) << (i * 7);
+    if (0 == (b & 0x80)) {
+      *val = v;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+int xdl_lzma_get_uncompressed_size(const uint8_t *src, size_t src_size, size_t *size) {
+  // ignore stream padding
+  while (src_size >= 4 && 0 == src[src_size - 1] && 0 == src[src_size - 2] && 0 == src[src_size - 3] &&
+         0 == src[src_size - 4])
+    src_size -= 4;
+  if (src_size < XDL_LZMA_XZ_HEADER_SIZE + XDL_LZMA_XZ_FOOTER_SIZE) return -1;
+
+  // stream footer: CRC32, backward size, stream flags, "YZ"
+  const uint8_t *footer = src + src_size - XDL_LZMA_XZ_FOOTER_SIZE;
+  if ('Y' != footer[10] || 'Z' != footer[11]) return -1;
+  uint64_t backward_size = ((uint64_t)footer[4] | (uint64_t)footer[5] << 8 | (uint64_t)footer[6] << 16 |
+                            (uint64_t)footer[7] << 24);
+  backward_size = (backward_size + 1) * 4;
+  if (backward_size > src_size - XDL_LZMA_XZ_HEADER_SIZE - XDL_LZMA_XZ_FOOTER_SIZE) return -1;
+
+  // index: indicator, number of records, (unpadded size, uncompressed size) for each block
+  const uint8_t *p = footer - backward_size;
+  if (0x00 != *p++) return -1;
+  uint64_t records, total = 0;
+  if (0 != xdl_lzma_read_varint(&p, footer, &records)) return -1;
+  for (uint64_t i = 0; i < records; i++) {
+    uint64_t unpadded, uncompressed;
+    if (0 != xdl_lzma_read_varint(&p, footer, &unpadded)) return -1;
+    if (0 != xdl_lzma_read_varint(&p, footer, &uncompressed)) return -1;
+    if (uncompressed > SIZE_MAX - total) return -1;
+    total += uncompressed;
+  }
+  if (0 == total) return -1;
+
+  *size = (size_t)total;
+  return 0;
+}
+
+int xdl_lzma_decompress_to(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size) {
   size_t src_offset = 0;
   size_t dst_offset = 0;
   size_t src_remaining;
@@ -126,62 +201,71 @@ int xdl_lzma_decompress(uint8_t *src, size_t src_size, uint8_t **dst, size_t *ds
   long long state[4096 / sizeof(long long)];  // must be enough, 8-bit aligned
   ECoderStatus status;
   int api_level = xdl_util_get_api_level();
+  int r = -1;
 
   // init and check
-  static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
-  static bool inited = false;
-  if (!inited) {
-    pthread_mutex_lock(&lock);
-    if (!inited) {
-      xdl_lzma_init();
-      inited = true;
-    }
-    pthread_mutex_unlock(&lock);
-  }
-  if (NULL == xdl_lzma_code) return -1;
+  if (0 != xdl_lzma_init_once()) return -1;
 
   xdl_lzma_construct(&state, &alloc);
 
-  *dst_size = 2 * src_size;
-  *dst = NULL;
   do {
-    *dst_size *= 2;
-    if (NULL == (*dst = realloc(*dst, *dst_size))) {
-      xdl_lzma_free(&state);
-      return -1;
-    }
-
     src_remaining = src_size - src_offset;
-    dst_remaining = *dst_size - dst_offset;
-
-    int result;
-    if (api_level >= __ANDROID_API_Q__) {
-      xdl_lzma_code_q_t lzma_code_q = (xdl_lzma_code_q_t)xdl_lzma_code;
-      result = lzma_code_q(&state, *dst + dst_offset, &dst_remaining, src + src_offset, &src_remaining, 1,
-                           CODER_FINISH_ANY, &status);
-    } else {
-      xdl_lzma_code_t lzma_code = (xdl_lzma_code_t)xdl_lzma_code;
-      result = lzma_code(&state, *dst + dst_offset, &dst_remaining, src + src_offset, &src_remaining,
-                         CODER_FINISH_ANY, &status);
-    }
-    if (SZ_OK != result) {
-      free(*dst);
-      xdl_lzma_free(&state);
-      return -1;
-    }
+    dst_remaining = dst_size - dst_offset;
+
+    if (SZ_OK != xdl_lzma_code_step(&state, dst + dst_offset, &dst_remaining, src + src_offset, &src_remaining,
+                                    &status, api_level))
+      goto end;
+
+    // no progress with a full output buffer: the size was wrong
+    if (0 == src_remaining && 0 == dst_remaining && status == CODER_STATUS_NOT_FINISHED) goto end;
 
     src_offset += src_remaining;
     dst_offset += dst_remaining;
   } while (status == CODER_STATUS_NOT_FINISHED);
 
+  if (xdl_lzma_isfinished(&state) && dst_offset == dst_size) r = 0;
+
+end:
   xdl_lzma_free(&state);
+  return r;
+}
 
-  if (!xdl_lzma_isfinished(&state)) {
-    free(*dst);
-    return -1;
-  }
+#define XDL_LZMA_WINDOW_SIZE (256 * 1024)
 
-  *dst_size = dst_offset;
-  *dst = realloc(*dst, *dst_size);
-  return 0;
+int xdl_lzma_decompress_stream(const uint8_t *src, size_t src_size, xdl_lzma_write_cb_t cb, void *arg) {
+  size_t src_offset = 0;
+  size_t src_remaining;
+  size_t dst_remaining;
+  ISzAlloc alloc = {.Alloc = xdl_lzma_internal_alloc, .Free = xdl_lzma_internal_free};
+  long long state[4096 / sizeof(long long)];  // must be enough, 8-bit aligned
+  ECoderStatus status;
+  int api_level = xdl_util_get_api_level();
+  int r = -1;
+
+  // init and check
+  if (0 != xdl_lzma_init_once()) return -1;
+
+  uint8_t *window = malloc(XDL_LZMA_WINDOW_SIZE);
+  if (NULL == window) return -1;
+
+  xdl_lzma_construct(&state, &alloc);
+
+  do {
+    src_remaining = src_size - src_offset;
+    dst_remaining = XDL_LZMA_WINDOW_SIZE;
+
+    if (SZ_OK != xdl_lzma_code_step(&state, window, &dst_remaining, src + src_offset, &src_remaining, &status,
+                                    api_level))
+      goto end;
+
+    src_offset += src_remaining;
+    if (dst_remaining > 0 && 0 != cb(window, dst_remaining, arg)) goto end;
+  } while (status == CODER_STATUS_NOT_FINISHED);
+
+  if (xdl_lzma_isfinished(&state)) r = 0;
+
+end:
+  xdl_lzma_free(&state);
+  free(window);
+  return r;
 }
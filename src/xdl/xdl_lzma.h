@@ -31,7 +31,16 @@
 extern "C" {
 #endif
 
-int xdl_lzma_decompress(uint8_t *src, size_t src_size, uint8_t **dst, size_t *dst_size);
+// Uncompressed size recorded in the index of a single-stream .xz, nothing is decoded.
+int xdl_lzma_get_uncompressed_size(const uint8_t *src, size_t src_size, size_t *size);
+
+// Decompress into dst, which must be exactly as large as the uncompressed data.
+int xdl_lzma_decompress_to(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size);
+
+// Decompress through a fixed-size window, handing each filled window to cb().
+// A non-zero return from cb() aborts the decompression.
+typedef int (*xdl_lzma_write_cb_t)(const uint8_t *buf, size_t len, void *arg);
+int xdl_lzma_decompress_stream(const uint8_t *src, size_t src_size, xdl_lzma_write_cb_t cb, void *arg);
 
 #ifdef __cplusplus
 }
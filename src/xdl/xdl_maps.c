@@ -0,0 +1,182 @@
+// Copyright (c) 2020-2023 HexHacking Team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include "xdl_maps.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define XDL_MAPS_READ_CHUNK (64 * 1024)
+
+static int xdl_maps_read_all(const char *pathname, char **buf, size_t *buf_sz) {
+  int fd = open(pathname, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return -1;
+
+  char *data = NULL;
+  size_t len = 0, cap = 0;
+  while (1) {
+    if (cap - len < XDL_MAPS_READ_CHUNK) {
+      size_t new_cap = (0 == cap ? XDL_MAPS_READ_CHUNK * 4 : cap * 2);
+      char *new_data = (char *)realloc(data, new_cap + 1);
+      if (NULL == new_data) goto err;
+      data = new_data;
+      cap = new_cap;
+    }
+
+    ssize_t n = read(fd, data + len, cap - len);
+    if (n < 0) {
+      if (EINTR == errno) continue;
+      goto err;
+    }
+    if (0 == n) break;
+    len += (size_t)n;
+  }
+  close(fd);
+
+  data[len] = '\0';
+  *buf = data;
+  *buf_sz = len;
+  return 0;
+
+err:
+  close(fd);
+  free(data);
+  return -1;
+}
+
+static bool xdl_maps_parse_hex(char **p, char *end, uintptr_t *val) {
+  uintptr_t v = 0;
+  char *s = *p;
+  while (s < end) {
+    char c = *s;
+    if (c >= '0' && c <= '9')
+      v = (v << 4) | (uintptr_t)(c - '0');
+    else if (c >= 'a' && c <= 'f')
+      v = (v << 4) | (uintptr_t)(c - 'a' + 10);
+    else if (c >= 'A' && c <= 'F')
+      v = (v << 4) | (uintptr_t)(c - 'A' + 10);
+    else
+      break;
+    s++;
+  }
+  if (s == *p) return false;
+  *p = s;
+  *val = v;
+  return true;
+}
+
+static char *xdl_maps_skip_field(char *p, char *end) {
+  while (p < end && ' ' != *p) p++;
+  while (p < end && ' ' == *p) p++;
+  return p;
+}
+
+// "start-end perms offset dev inode    pathname"
+static bool xdl_maps_parse_line(char *line, char *end, xdl_maps_entry_t *entry) {
+  char *p = line;
+  if (!xdl_maps_parse_hex(&p, end, &entry->start) || p >= end || '-' != *p++) return false;
+  if (!xdl_maps_parse_hex(&p, end, &entry->end) || p >= end || ' ' != *p++) return false;
+
+  if (end - p < 5) return false;
+  entry->readable = ('r' == p[0]);
+  entry->writable = ('w' == p[1]);
+  entry->executable = ('x' == p[2]);
+  entry->is_private = ('p' == p[3]);
+  p = xdl_maps_skip_field(p, end);
+
+  if (!xdl_maps_parse_hex(&p, end, &entry->offset)) return false;
+  while (p < end && ' ' == *p) p++;
+  p = xdl_maps_skip_field(p, end);  // dev
+  p = xdl_maps_skip_field(p, end);  // inode
+
+  // pathname, trimmed and terminated in place
+  char *pathname_end = end;
+  while (pathname_end > p && (' ' == pathname_end[-1] || '\t' == pathname_end[-1] || '\r' == pathname_end[-1]))
+    pathname_end--;
+  *pathname_end = '\0';
+  entry->pathname = p;
+  return true;
+}
+
+static int xdl_maps_entry_cmp(const void *a, const void *b) {
+  const xdl_maps_entry_t *ea = (const xdl_maps_entry_t *)a;
+  const xdl_maps_entry_t *eb = (const xdl_maps_entry_t *)b;
+  if (ea->start == eb->start) return 0;
+  return ea->start < eb->start ? -1 : 1;
+}
+
+int xdl_maps_load(xdl_maps_t *self, const char *pathname) {
+  memset(self, 0, sizeof(xdl_maps_t));
+  if (0 != xdl_maps_read_all(NULL == pathname ? "/proc/self/maps" : pathname, &self->buf, &self->buf_sz))
+    return -1;
+
+  char *buf_end = self->buf + self->buf_sz;
+  size_t lines = 1;
+  for (char *p = self->buf; NULL != (p = memchr(p, '\n', (size_t)(buf_end - p))); p++) lines++;
+
+  self->entries = (xdl_maps_entry_t *)malloc(lines * sizeof(xdl_maps_entry_t));
+  if (NULL == self->entries) {
+    xdl_maps_free(self);
+    return -1;
+  }
+
+  bool sorted = true;
+  for (char *line = self->buf; line < buf_end;) {
+    char *eol = memchr(line, '\n', (size_t)(buf_end - line));
+    if (NULL == eol) eol = buf_end;
+
+    xdl_maps_entry_t *entry = &self->entries[self->entries_cnt];
+    if (xdl_maps_parse_line(line, eol, entry)) {
+      if (self->entries_cnt > 0 && entry->start < self->entries[self->entries_cnt - 1].start) sorted = false;
+      self->entries_cnt++;
+    }
+    line = eol + 1;
+  }
+
+  // the kernel already prints them in order
+  if (!sorted) qsort(self->entries, self->entries_cnt, sizeof(xdl_maps_entry_t), xdl_maps_entry_cmp);
+  return 0;
+}
+
+void xdl_maps_free(xdl_maps_t *self) {
+  free(self->entries);
+  free(self->buf);
+  memset(self, 0, sizeof(xdl_maps_t));
+}
+
+const xdl_maps_entry_t *xdl_maps_find(const xdl_maps_t *self, uintptr_t addr) {
+  size_t lo = 0, hi = self->entries_cnt;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (self->entries[mid].start <= addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (0 == lo || addr >= self->entries[lo - 1].end) return NULL;
+  return &self->entries[lo - 1];
+}
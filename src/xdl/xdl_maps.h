@@ -0,0 +1,65 @@
+// Copyright (c) 2020-2023 HexHacking Team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#ifndef IO_GITHUB_HEXHACKING_XDL_MAPS
+#define IO_GITHUB_HEXHACKING_XDL_MAPS
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One line of /proc/<pid>/maps.
+typedef struct {
+  uintptr_t start;
+  uintptr_t end;
+  uintptr_t offset;
+  bool readable;
+  bool writable;
+  bool executable;
+  bool is_private;
+  const char *pathname;  // "" for anonymous mappings, points into the snapshot
+} xdl_maps_entry_t;
+
+// A snapshot of the whole file, sorted by start address.
+typedef struct {
+  xdl_maps_entry_t *entries;
+  size_t entries_cnt;
+  char *buf;  // the raw text, pathnames are terminated in place
+  size_t buf_sz;
+} xdl_maps_t;
+
+// pathname: NULL for "/proc/self/maps"
+int xdl_maps_load(xdl_maps_t *self, const char *pathname);
+void xdl_maps_free(xdl_maps_t *self);
+
+// O(log n), NULL if addr is not mapped
+const xdl_maps_entry_t *xdl_maps_find(const xdl_maps_t *self, uintptr_t addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,127 @@
+// Copyright (c) 2020-2023 HexHacking Team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#ifndef IO_GITHUB_HEXHACKING_XDL_MATCH
+#define IO_GITHUB_HEXHACKING_XDL_MATCH
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define XDL_PREFIX16_SIMD 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define XDL_PREFIX16_SIMD 1
+#endif
+
+#include "xdl_util.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// clang-format off
+/*
+ * For internal symbols in .symtab, LLVM may add some suffixes (for example for thinLTO).
+ * The format of the suffix is: ".xxxx.[hash]". LLVM may add multiple suffixes at once.
+ * The symbol name after removing these all suffixes is called canonical name.
+ *
+ * Because the hash part in the suffix may change when recompiled, so here we only match
+ * the canonical name.
+ *
+ * IN ADDITION: According to C/C++ syntax, it is illegal for a function name to contain
+ * dot character('.'), either in the middle or at the end.
+ *
+ * samples:
+ *
+ * symbol name in .symtab          lookup                       is match
+ * ----------------------          ----------------             --------
+ * abcd                            abc                          N
+ * abcd                            abcd                         Y
+ * abcd                            abcde                        N
+ * abcd.llvm.10190306339727611508  abc                          N
+ * abcd.llvm.10190306339727611508  abcd                         Y
+ * abcd.llvm.10190306339727611508  abcd.                        N
+ * abcd.llvm.10190306339727611508  abcd.llvm                    Y
+ * abcd.llvm.10190306339727611508  abcd.llvm.                   N
+ * abcd.__uniq.513291356003753     abcd.__uniq.51329            N
+ * abcd.__uniq.513291356003753     abcd.__uniq.513291356003753  Y
+ */
+// clang-format on
+static inline bool xdl_dsym_is_match(const char *str, const char *sym, size_t str_len) {
+  if (__predict_false(0 == str_len)) return false;
+
+  do {
+    if (*str != *sym) return __predict_false('.' == *str && '\0' == *sym);
+    str++;
+    sym++;
+    if ('\0' == *str) break;
+  } while (0 != --str_len);
+
+  return '\0' == *sym;
+}
+
+// The first (up to) 16 literal bytes of a lookup, checked against a name with one vector compare
+// before the byte-by-byte matcher runs. Long scans mostly reject names sharing a prefix with the
+// lookup (e.g. "_ZN3art"), where the byte loop would take a branch per shared character.
+typedef struct {
+  uint8_t bytes[16];
+  size_t len;  // 0: no prefilter
+} xdl_prefix16_t;
+
+static inline void xdl_prefix16_init(xdl_prefix16_t *self, const char *literal, size_t literal_len) {
+  memset(self, 0, sizeof(xdl_prefix16_t));
+#ifdef XDL_PREFIX16_SIMD
+  self->len = literal_len < sizeof(self->bytes) ? literal_len : sizeof(self->bytes);
+  if (self->len > 0) memcpy(self->bytes, literal, self->len);
+#else
+  (void)literal, (void)literal_len;
+#endif
+}
+
+// str must have 16 readable bytes; false: the first len bytes of str differ from the literal
+static inline bool xdl_prefix16_may_match(const xdl_prefix16_t *self, const char *str) {
+#if defined(__ARM_NEON)
+  uint8x16_t eq = vceqq_u8(vld1q_u8((const uint8_t *)str), vld1q_u8(self->bytes));
+  // 4 bits per byte
+  uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+  uint64_t need = 16 == self->len ? UINT64_MAX : ((uint64_t)1 << (self->len * 4)) - 1;
+  return (bits & need) == need;
+#elif defined(__SSE2__)
+  __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(const void *)str),
+                              _mm_loadu_si128((const __m128i *)(const void *)self->bytes));
+  unsigned int need = (1U << self->len) - 1;
+  return ((unsigned int)_mm_movemask_epi8(eq) & need) == need;
+#else
+  (void)self, (void)str;
+  return true;
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,282 @@
+// Copyright (c) 2020-2023 HexHacking Team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include "xdl_registry.h"
+
+#include <link.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xdl.h"
+#include "xdl_iterate.h"
+#include "xdl_util.h"
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+
+typedef struct {
+  char *pathname;
+  ElfW(Addr) load_bias;
+  const ElfW(Phdr) *dlpi_phdr;
+  ElfW(Half) dlpi_phnum;
+  const ElfW(Addr) *bloom;  // GNU hash bloom filter in the ELF, copied to xdl_registry.bloom
+  size_t bloom_offset;      // into xdl_registry.bloom
+  uint32_t bloom_cnt;       // 0 for ELFs without GNU hash
+  uint32_t bloom_shift;
+} xdl_registry_module_t;
+
+typedef struct {
+  const char *key;  // full pathname or basename, NULL for empty slot
+  uint32_t hash;
+  size_t module_idx;
+} xdl_registry_slot_t;
+
+typedef struct {
+  pthread_mutex_t lock;
+  bool valid;
+  unsigned long long adds;
+  unsigned long long subs;
+  xdl_registry_module_t *modules;
+  size_t modules_cnt;
+  size_t modules_cap;
+  xdl_registry_slot_t *slots;
+  size_t slots_cnt;  // power of 2
+  ElfW(Addr) *bloom;  // the bloom words of all modules side by side
+} xdl_registry_t;
+
+#pragma clang diagnostic pop
+
+static xdl_registry_t xdl_registry = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static uint32_t xdl_registry_hash(const char *str) {
+  uint32_t h = 5381;
+
+  while (*str) {
+    h += (h << 5) + (uint8_t)*str++;
+  }
+  return h;
+}
+
+static void xdl_registry_clear(void) {
+  for (size_t i = 0; i < xdl_registry.modules_cnt; i++) free(xdl_registry.modules[i].pathname);
+  free(xdl_registry.modules);
+  free(xdl_registry.slots);
+  free(xdl_registry.bloom);
+  xdl_registry.modules = NULL;
+  xdl_registry.modules_cnt = 0;
+  xdl_registry.modules_cap = 0;
+  xdl_registry.slots = NULL;
+  xdl_registry.slots_cnt = 0;
+  xdl_registry.bloom = NULL;
+  xdl_registry.valid = false;
+}
+
+static void xdl_registry_get_bloom(struct dl_phdr_info *info, xdl_registry_module_t *module) {
+  module->bloom = NULL;
+  module->bloom_offset = 0;
+  module->bloom_cnt = 0;
+  module->bloom_shift = 0;
+
+  for (size_t i = 0; i < info->dlpi_phnum; i++) {
+    const ElfW(Phdr) *phdr = &(info->dlpi_phdr[i]);
+    if (PT_DYNAMIC != phdr->p_type) continue;
+
+    for (ElfW(Dyn) *entry = (ElfW(Dyn) *)(info->dlpi_addr + phdr->p_vaddr); DT_NULL != entry->d_tag; entry++) {
+      if (DT_GNU_HASH != entry->d_tag) continue;
+
+      // nbuckets, symoffset, bloom_size, bloom_shift, then the bloom words
+      ElfW(Addr) vaddr = XDL_UTIL_DYN_PTR_TO_VADDR(entry->d_un.d_ptr, info->dlpi_addr);
+      const uint32_t *hash = (const uint32_t *)(info->dlpi_addr + vaddr);
+      if (0 == hash[0] || 0 == hash[2]) return;
+      module->bloom = (const ElfW(Addr) *)(&(hash[4]));
+      module->bloom_cnt = hash[2];
+      module->bloom_shift = hash[3];
+      return;
+    }
+    return;
+  }
+}
+
+static int xdl_registry_collect_cb(struct dl_phdr_info *info, size_t size, void *arg) {
+  (void)size, (void)arg;
+
+  // same filter as xdl_find()
+  if (0 == info->dlpi_addr || NULL == info->dlpi_name) return 0;
+
+  if (xdl_registry.modules_cnt == xdl_registry.modules_cap) {
+    size_t cap = xdl_registry.modules_cap > 0 ? xdl_registry.modules_cap * 2 : 256;
+    xdl_registry_module_t *modules =
+        (xdl_registry_module_t *)realloc(xdl_registry.modules, cap * sizeof(xdl_registry_module_t));
+    if (NULL == modules) return 1;  // failed
+    xdl_registry.modules = modules;
+    xdl_registry.modules_cap = cap;
+  }
+
+  xdl_registry_module_t *module = &xdl_registry.modules[xdl_registry.modules_cnt];
+  if (NULL == (module->pathname = strdup(info->dlpi_name))) return 1;  // failed
+  module->load_bias = info->dlpi_addr;
+  module->dlpi_phdr = info->dlpi_phdr;
+  module->dlpi_phnum = info->dlpi_phnum;
+  xdl_registry_get_bloom(info, module);
+  xdl_registry.modules_cnt++;
+  return 0;
+}
+
+static xdl_registry_slot_t *xdl_registry_lookup(const char *key, uint32_t hash) {
+  size_t mask = xdl_registry.slots_cnt - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    xdl_registry_slot_t *slot = &xdl_registry.slots[i];
+    if (NULL == slot->key || (slot->hash == hash && 0 == strcmp(slot->key, key))) return slot;
+  }
+}
+
+static void xdl_registry_insert(const char *key, size_t module_idx) {
+  uint32_t hash = xdl_registry_hash(key);
+  xdl_registry_slot_t *slot = xdl_registry_lookup(key, hash);
+  if (NULL != slot->key) return;  // the first one in the link map wins, same as the linear search
+
+  slot->key = key;
+  slot->hash = hash;
+  slot->module_idx = module_idx;
+}
+
+static int xdl_registry_build(void) {
+  xdl_registry_clear();
+  if (0 != xdl_iterate_phdr_impl(xdl_registry_collect_cb, NULL, XDL_DEFAULT)) goto err;
+
+  // two keys for each module, keep the load factor under 1/2
+  size_t slots_cnt = 64;
+  while (slots_cnt < xdl_registry.modules_cnt * 4) slots_cnt <<= 1;
+  if (NULL == (xdl_registry.slots = (xdl_registry_slot_t *)calloc(slots_cnt, sizeof(xdl_registry_slot_t))))
+    goto err;
+  xdl_registry.slots_cnt = slots_cnt;
+
+  for (size_t i = 0; i < xdl_registry.modules_cnt; i++) {
+    const char *pathname = xdl_registry.modules[i].pathname;
+    xdl_registry_insert(pathname, i);
+
+    const char *basename = strrchr(pathname, '/');
+    if (NULL != basename && '\0' != basename[1]) xdl_registry_insert(basename + 1, i);
+  }
+
+  // copy the bloom words of all modules into one array, a lookup then reads one word per module
+  size_t bloom_total = 0;
+  for (size_t i = 0; i < xdl_registry.modules_cnt; i++) {
+    xdl_registry.modules[i].bloom_offset = bloom_total;
+    bloom_total += xdl_registry.modules[i].bloom_cnt;
+  }
+  if (bloom_total > 0) {
+    if (NULL == (xdl_registry.bloom = (ElfW(Addr) *)malloc(bloom_total * sizeof(ElfW(Addr))))) goto err;
+    for (size_t i = 0; i < xdl_registry.modules_cnt; i++) {
+      xdl_registry_module_t *module = &xdl_registry.modules[i];
+      memcpy(xdl_registry.bloom + module->bloom_offset, module->bloom, module->bloom_cnt * sizeof(ElfW(Addr)));
+    }
+  }
+
+  xdl_registry.valid = true;
+  return 0;
+
+err:
+  xdl_registry_clear();
+  return -1;
+}
+
+// rebuild only when the link map has changed
+static int xdl_registry_update(unsigned long long adds, unsigned long long subs) {
+  if (xdl_registry.valid && adds == xdl_registry.adds && subs == xdl_registry.subs) return 0;
+
+  if (0 != xdl_registry_build()) return -1;
+  xdl_registry.adds = adds;
+  xdl_registry.subs = subs;
+  return 0;
+}
+
+int xdl_registry_find(const char *filename, struct dl_phdr_info *info, char *buf, size_t buf_len) {
+  // relative paths with directories are left to the linear search
+  if ('/' != filename[0] && '[' != filename[0] && NULL != strchr(filename, '/')) return -1;
+
+  unsigned long long adds, subs;
+  if (0 != xdl_iterate_get_counters(&adds, &subs)) return -1;
+
+  int r = -1;
+  pthread_mutex_lock(&xdl_registry.lock);
+  if (0 != xdl_registry_update(adds, subs)) goto end;
+
+  xdl_registry_slot_t *slot = xdl_registry_lookup(filename, xdl_registry_hash(filename));
+  if (NULL == slot->key) goto end;
+
+  xdl_registry_module_t *module = &xdl_registry.modules[slot->module_idx];
+  if (strlen(module->pathname) >= buf_len) goto end;
+  strcpy(buf, module->pathname);
+
+  memset(info, 0, sizeof(struct dl_phdr_info));
+  info->dlpi_addr = module->load_bias;
+  info->dlpi_name = buf;
+  info->dlpi_phdr = module->dlpi_phdr;
+  info->dlpi_phnum = module->dlpi_phnum;
+  r = 0;
+
+end:
+  pthread_mutex_unlock(&xdl_registry.lock);
+  return r;
+}
+
+int xdl_registry_iterate_by_gnu_hash(uint32_t gnu_hash, xdl_registry_cb_t cb, void *arg) {
+  // without the counters, a snapshot only lives for this call
+  unsigned long long adds = 0, subs = 0;
+  bool counters = (0 == xdl_iterate_get_counters(&adds, &subs));
+
+  int r = -1;
+  pthread_mutex_lock(&xdl_registry.lock);
+  if (counters ? 0 != xdl_registry_update(adds, subs) : 0 != xdl_registry_build()) goto end;
+
+  static const uint32_t elfclass_bits = sizeof(ElfW(Addr)) * 8;
+  size_t mask_gnu = (size_t)1 << (gnu_hash % elfclass_bits);
+  r = 0;
+  for (size_t i = 0; i < xdl_registry.modules_cnt; i++) {
+    xdl_registry_module_t *module = &xdl_registry.modules[i];
+
+    if (module->bloom_cnt > 0) {
+      // most ELFs are rejected here without touching their own pages
+      size_t word = xdl_registry.bloom[module->bloom_offset + (gnu_hash / elfclass_bits) % module->bloom_cnt];
+      size_t mask = mask_gnu | (size_t)1 << ((gnu_hash >> module->bloom_shift) % elfclass_bits);
+      if ((word & mask) != mask) continue;
+    }
+
+    struct dl_phdr_info info;
+    memset(&info, 0, sizeof(struct dl_phdr_info));
+    info.dlpi_addr = module->load_bias;
+    info.dlpi_name = module->pathname;
+    info.dlpi_phdr = module->dlpi_phdr;
+    info.dlpi_phnum = module->dlpi_phnum;
+    if (0 != (r = cb(&info, arg))) break;
+  }
+
+end:
+  if (!counters) xdl_registry_clear();
+  pthread_mutex_unlock(&xdl_registry.lock);
+  return r;
+}
@@ -0,0 +1,50 @@
+// Copyright (c) 2020-2023 HexHacking Team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#ifndef IO_GITHUB_HEXHACKING_XDL_REGISTRY
+#define IO_GITHUB_HEXHACKING_XDL_REGISTRY
+
+#include <link.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Process-wide index of the loaded ELFs by pathname and basename. It is rebuilt only when the
+// dlpi_adds/dlpi_subs counters change, and is not available when they are not (API level < 30).
+// On success, info->dlpi_name points to buf.
+int xdl_registry_find(const char *filename, struct dl_phdr_info *info, char *buf, size_t buf_len);
+
+// Calls cb in link map order with each loaded ELF whose GNU hash bloom filter may contain a symbol
+// with gnu_hash, and with each ELF without GNU hash, until cb returns non-zero. Returns that value,
+// 0 if cb never did, -1 on error. cb runs under the registry lock. Without the counters, the
+// snapshot is built for this call only.
+typedef int (*xdl_registry_cb_t)(struct dl_phdr_info *info, void *arg);
+int xdl_registry_iterate_by_gnu_hash(uint32_t gnu_hash, xdl_registry_cb_t cb, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
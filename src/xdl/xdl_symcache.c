@@ -0,0 +1,275 @@
+// Copyright (c) 2020-2023 HexHacking Team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include "xdl_symcache.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <link.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "xdl_util.h"
+
+#define XDL_SYMCACHE_MAGIC        0x43584458  // "XDXC"
+#define XDL_SYMCACHE_VERSION      1
+#define XDL_SYMCACHE_BUILD_ID_MAX 64
+#define XDL_SYMCACHE_ALIGN        8
+
+#define XDL_SYMCACHE_UNCHECKED 0
+#define XDL_SYMCACHE_VALID     1
+#define XDL_SYMCACHE_INVALID   2
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+
+// file layout: header, library records, then .symtab (aligned) & .strtab of each library
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t sym_size;  // sizeof(ElfW(Sym)), tells ELFCLASS32 from ELFCLASS64
+  uint32_t libs_cnt;
+  uint64_t libs_offset;
+} xdl_symcache_header_t;
+
+typedef struct {
+  uint32_t build_id_sz;
+  uint8_t build_id[XDL_SYMCACHE_BUILD_ID_MAX];
+  uint64_t symtab_offset;
+  uint64_t symtab_cnt;
+  uint64_t strtab_offset;
+  uint64_t strtab_sz;
+} xdl_symcache_lib_rec_t;
+
+typedef struct {
+  void *map;
+  size_t map_sz;
+  const xdl_symcache_lib_rec_t *libs;
+  uint32_t libs_cnt;
+  atomic_int *states;  // XDL_SYMCACHE_*, the symbols of a library are checked on its first use
+} xdl_symcache_table_t;
+
+#pragma clang diagnostic pop
+
+static _Atomic(xdl_symcache_table_t *) xdl_symcache_table = NULL;
+
+static uint64_t xdl_symcache_align(uint64_t offset) {
+  return (offset + XDL_SYMCACHE_ALIGN - 1) & ~(uint64_t)(XDL_SYMCACHE_ALIGN - 1);
+}
+
+static bool xdl_symcache_lib_is_used(const xdl_symcache_lib_t *lib) {
+  return 0 != lib->build_id_sz && lib->build_id_sz <= XDL_SYMCACHE_BUILD_ID_MAX && NULL != lib->symtab &&
+         0 != lib->symtab_cnt && NULL != lib->strtab && 0 != lib->strtab_sz;
+}
+
+static int xdl_symcache_write(int fd, const void *buf, size_t len) {
+  const uint8_t *p = (const uint8_t *)buf;
+  while (len > 0) {
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wgnu-statement-expression"
+    ssize_t n = XDL_UTIL_TEMP_FAILURE_RETRY(write(fd, p, len));
+#pragma clang diagnostic pop
+    if (n <= 0) return -1;
+    p += n;
+    len -= (size_t)n;
+  }
+  return 0;
+}
+
+int xdl_symcache_save(const char *pathname, const xdl_symcache_lib_t *libs, size_t libs_cnt) {
+  if (NULL == pathname || (NULL == libs && libs_cnt > 0)) return -1;
+
+  // records and offsets, the tables themselves are written from where they are
+  size_t used_libs_cnt = 0;
+  for (size_t i = 0; i < libs_cnt; i++)
+    if (xdl_symcache_lib_is_used(&libs[i])) used_libs_cnt++;
+  if (used_libs_cnt > UINT32_MAX) return -1;
+
+  xdl_symcache_header_t hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = XDL_SYMCACHE_MAGIC;
+  hdr.version = XDL_SYMCACHE_VERSION;
+  hdr.sym_size = sizeof(ElfW(Sym));
+  hdr.libs_cnt = (uint32_t)used_libs_cnt;
+  hdr.libs_offset = xdl_symcache_align(sizeof(hdr));
+
+  xdl_symcache_lib_rec_t *lib_recs = (xdl_symcache_lib_rec_t *)calloc(used_libs_cnt + 1, sizeof(*lib_recs));
+  if (NULL == lib_recs) return -1;
+  uint64_t offset = hdr.libs_offset + used_libs_cnt * sizeof(xdl_symcache_lib_rec_t);
+  for (size_t i = 0, j = 0; i < libs_cnt; i++) {
+    const xdl_symcache_lib_t *lib = &libs[i];
+    if (!xdl_symcache_lib_is_used(lib)) continue;
+
+    xdl_symcache_lib_rec_t *rec = &lib_recs[j++];
+    rec->build_id_sz = (uint32_t)lib->build_id_sz;
+    memcpy(rec->build_id, lib->build_id, lib->build_id_sz);
+    rec->symtab_offset = xdl_symcache_align(offset);
+    rec->symtab_cnt = lib->symtab_cnt;
+    rec->strtab_offset = rec->symtab_offset + lib->symtab_cnt * sizeof(ElfW(Sym));
+    rec->strtab_sz = lib->strtab_sz;
+    offset = rec->strtab_offset + lib->strtab_sz;
+  }
+
+  // write to a private temporary file, then publish it atomically
+  int r = -1;
+  char tmp_pathname[PATH_MAX + 32];
+  snprintf(tmp_pathname, sizeof(tmp_pathname), "%s.%d.tmp", pathname, getpid());
+  int fd = open(tmp_pathname, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) goto end;
+  fchmod(fd, 0644);  // readable by apps regardless of the umask of the writer
+
+  static const uint8_t zeros[XDL_SYMCACHE_ALIGN];
+  if (0 != xdl_symcache_write(fd, &hdr, sizeof(hdr))) goto err;
+  if (0 != xdl_symcache_write(fd, zeros, (size_t)(hdr.libs_offset - sizeof(hdr)))) goto err;
+  if (0 != xdl_symcache_write(fd, lib_recs, used_libs_cnt * sizeof(xdl_symcache_lib_rec_t))) goto err;
+  offset = hdr.libs_offset + used_libs_cnt * sizeof(xdl_symcache_lib_rec_t);
+  for (size_t i = 0, j = 0; i < libs_cnt; i++) {
+    const xdl_symcache_lib_t *lib = &libs[i];
+    if (!xdl_symcache_lib_is_used(lib)) continue;
+
+    const xdl_symcache_lib_rec_t *rec = &lib_recs[j++];
+    if (0 != xdl_symcache_write(fd, zeros, (size_t)(rec->symtab_offset - offset))) goto err;
+    if (0 != xdl_symcache_write(fd, lib->symtab, lib->symtab_cnt * sizeof(ElfW(Sym)))) goto err;
+    if (0 != xdl_symcache_write(fd, lib->strtab, lib->strtab_sz)) goto err;
+    offset = rec->strtab_offset + rec->strtab_sz;
+  }
+  if (0 != close(fd)) {
+    fd = -1;
+    goto err;
+  }
+  fd = -1;
+  if (0 != rename(tmp_pathname, pathname)) goto err;
+  r = 0;
+  goto end;
+
+err:
+  if (fd >= 0) close(fd);
+  unlink(tmp_pathname);
+end:
+  free(lib_recs);
+  return r;
+}
+
+static xdl_symcache_table_t *xdl_symcache_load(const char *pathname) {
+  int fd = open(pathname, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return NULL;
+  struct stat st;
+  if (0 != fstat(fd, &st) || (size_t)st.st_size < sizeof(xdl_symcache_header_t)) {
+    close(fd);
+    return NULL;
+  }
+  size_t map_sz = (size_t)st.st_size;
+  void *map = mmap(NULL, map_sz, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (MAP_FAILED == map) return NULL;
+
+  // check header
+  xdl_symcache_header_t *hdr = (xdl_symcache_header_t *)map;
+  if (XDL_SYMCACHE_MAGIC != hdr->magic || XDL_SYMCACHE_VERSION != hdr->version) goto err;
+  if (sizeof(ElfW(Sym)) != hdr->sym_size) goto err;
+
+  // check bounds, the symbols are checked on first use
+  if (0 != hdr->libs_offset % XDL_SYMCACHE_ALIGN) goto err;
+  if (hdr->libs_offset > map_sz ||
+      hdr->libs_cnt > (map_sz - hdr->libs_offset) / sizeof(xdl_symcache_lib_rec_t))
+    goto err;
+  const xdl_symcache_lib_rec_t *libs = (const xdl_symcache_lib_rec_t *)((uintptr_t)map + hdr->libs_offset);
+  for (uint32_t i = 0; i < hdr->libs_cnt; i++) {
+    const xdl_symcache_lib_rec_t *lib = &libs[i];
+    if (0 == lib->build_id_sz || lib->build_id_sz > XDL_SYMCACHE_BUILD_ID_MAX) goto err;
+    if (0 != lib->symtab_offset % XDL_SYMCACHE_ALIGN) goto err;
+    if (lib->symtab_offset > map_sz || lib->symtab_cnt > (map_sz - lib->symtab_offset) / sizeof(ElfW(Sym)))
+      goto err;
+    if (0 == lib->strtab_sz || lib->strtab_offset > map_sz || lib->strtab_sz > map_sz - lib->strtab_offset)
+      goto err;
+  }
+
+  xdl_symcache_table_t *table = (xdl_symcache_table_t *)malloc(sizeof(xdl_symcache_table_t));
+  if (NULL == table) goto err;
+  if (NULL == (table->states = (atomic_int *)calloc(hdr->libs_cnt + 1, sizeof(atomic_int)))) {
+    free(table);
+    goto err;
+  }
+  table->map = map;
+  table->map_sz = map_sz;
+  table->libs = libs;
+  table->libs_cnt = hdr->libs_cnt;
+  return table;
+
+err:
+  munmap(map, map_sz);
+  return NULL;
+}
+
+int xdl_symcache_set_file(const char *pathname) {
+  xdl_symcache_table_t *table = NULL;
+  if (NULL != pathname && NULL == (table = xdl_symcache_load(pathname))) return -1;
+
+  // a replaced table stays mapped, handles keep pointing into it
+  atomic_store_explicit(&xdl_symcache_table, table, memory_order_release);
+  return 0;
+}
+
+// every name has to be inside .strtab and end there, lookups read names without bounds
+static bool xdl_symcache_lib_check(xdl_symcache_table_t *table, uint32_t idx) {
+  int state = atomic_load_explicit(&table->states[idx], memory_order_acquire);
+  if (XDL_SYMCACHE_UNCHECKED != state) return XDL_SYMCACHE_VALID == state;
+
+  const xdl_symcache_lib_rec_t *lib = &table->libs[idx];
+  const ElfW(Sym) *symtab = (const ElfW(Sym) *)((uintptr_t)table->map + lib->symtab_offset);
+  const char *strtab = (const char *)((uintptr_t)table->map + lib->strtab_offset);
+  bool valid = '\0' == strtab[lib->strtab_sz - 1];
+  for (uint64_t i = 0; valid && i < lib->symtab_cnt; i++)
+    if (symtab[i].st_name >= lib->strtab_sz) valid = false;
+
+  // racing threads reach the same result
+  atomic_store_explicit(&table->states[idx], valid ? XDL_SYMCACHE_VALID : XDL_SYMCACHE_INVALID,
+                        memory_order_release);
+  return valid;
+}
+
+int xdl_symcache_find(const uint8_t *build_id, size_t build_id_sz, ElfW(Sym) **symtab, size_t *symtab_cnt,
+                      char **strtab, size_t *strtab_sz) {
+  xdl_symcache_table_t *table = atomic_load_explicit(&xdl_symcache_table, memory_order_acquire);
+  if (NULL == table) return -1;
+
+  for (uint32_t i = 0; i < table->libs_cnt; i++) {
+    const xdl_symcache_lib_rec_t *lib = &table->libs[i];
+    if (build_id_sz != lib->build_id_sz || 0 != memcmp(build_id, lib->build_id, build_id_sz)) continue;
+    if (!xdl_symcache_lib_check(table, i)) return -1;
+
+    *symtab = (ElfW(Sym) *)((uintptr_t)table->map + lib->symtab_offset);
+    *symtab_cnt = (size_t)lib->symtab_cnt;
+    *strtab = (char *)((uintptr_t)table->map + lib->strtab_offset);
+    *strtab_sz = (size_t)lib->strtab_sz;
+    return 0;
+  }
+  return -1;
+}
@@ -0,0 +1,58 @@
+// Copyright (c) 2020-2023 HexHacking Team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#ifndef IO_GITHUB_HEXHACKING_XDL_SYMCACHE
+#define IO_GITHUB_HEXHACKING_XDL_SYMCACHE
+
+#include <link.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Symbol cache: whole .symtab & .strtab pairs keyed by build-id, extracted ahead of time in another
+// process (from .symtab or .gnu_debugdata) and stored so that they can be used in place from a
+// read-only mapping of the file.
+typedef struct {
+  const uint8_t *build_id;
+  size_t build_id_sz;
+  const ElfW(Sym) *symtab;
+  size_t symtab_cnt;
+  const char *strtab;
+  size_t strtab_sz;
+} xdl_symcache_lib_t;
+
+int xdl_symcache_save(const char *pathname, const xdl_symcache_lib_t *libs, size_t libs_cnt);
+
+int xdl_symcache_set_file(const char *pathname);
+
+// return 0 and point into the cache when it has the build-id, -1 otherwise
+int xdl_symcache_find(const uint8_t *build_id, size_t build_id_sz, ElfW(Sym) **symtab, size_t *symtab_cnt,
+                      char **strtab, size_t *strtab_sz);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
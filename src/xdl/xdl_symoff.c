@@ -0,0 +1,278 @@
+// Copyright (c) 2020-2023 HexHacking Team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "xdl_symoff.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "xdl_util.h"
+
+#define XDL_SYMOFF_MAGIC        0x4f4c4458  // "XDLO"
+#define XDL_SYMOFF_VERSION      1
+#define XDL_SYMOFF_BUILD_ID_MAX 64
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+
+// file layout: header, symbol records (grouped by library, sorted by hash), library records, strings
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t libs_cnt;
+  uint32_t syms_cnt;
+  uint64_t syms_offset;
+  uint64_t libs_offset;
+  uint64_t strs_offset;
+  uint64_t strs_sz;
+} xdl_symoff_header_t;
+
+typedef struct {
+  uint32_t hash;
+  uint32_t name_offset;  // into the strings
+  uint64_t value;
+  uint64_t size;
+} xdl_symoff_sym_t;
+
+typedef struct {
+  uint32_t build_id_sz;
+  uint8_t build_id[XDL_SYMOFF_BUILD_ID_MAX];
+  uint32_t syms_idx;
+  uint32_t syms_cnt;
+} xdl_symoff_lib_rec_t;
+
+typedef struct {
+  void *map;
+  size_t map_sz;
+  const xdl_symoff_sym_t *syms;
+  const xdl_symoff_lib_rec_t *libs;
+  uint32_t libs_cnt;
+  const char *strs;
+  size_t strs_sz;
+} xdl_symoff_table_t;
+
+#pragma clang diagnostic pop
+
+static _Atomic(xdl_symoff_table_t *) xdl_symoff_table = NULL;
+
+static uint32_t xdl_symoff_hash(const char *name) {
+  uint32_t h = 5381;
+  while (*name) h += (h << 5) + (uint8_t)*name++;
+  return h;
+}
+
+static int xdl_symoff_sym_cmp(const void *a, const void *b) {
+  uint32_t ha = ((const xdl_symoff_sym_t *)a)->hash, hb = ((const xdl_symoff_sym_t *)b)->hash;
+  return ha < hb ? -1 : (ha > hb ? 1 : 0);
+}
+
+static int xdl_symoff_write(int fd, const void *buf, size_t len) {
+  const uint8_t *p = (const uint8_t *)buf;
+  while (len > 0) {
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wgnu-statement-expression"
+    ssize_t n = XDL_UTIL_TEMP_FAILURE_RETRY(write(fd, p, len));
+#pragma clang diagnostic pop
+    if (n <= 0) return -1;
+    p += n;
+    len -= (size_t)n;
+  }
+  return 0;
+}
+
+int xdl_symoff_save(const char *pathname, const xdl_symoff_lib_t *libs, size_t libs_cnt) {
+  if (NULL == pathname || (NULL == libs && libs_cnt > 0)) return -1;
+
+  // sizes
+  size_t syms_cnt = 0, strs_sz = 1, used_libs_cnt = 0;
+  for (size_t i = 0; i < libs_cnt; i++) {
+    if (0 == libs[i].build_id_sz || libs[i].build_id_sz > XDL_SYMOFF_BUILD_ID_MAX) continue;
+    used_libs_cnt++;
+    syms_cnt += libs[i].cnt;
+    for (size_t j = 0; j < libs[i].cnt; j++) strs_sz += strlen(libs[i].names[j]) + 1;
+  }
+  if (syms_cnt > UINT32_MAX || strs_sz > UINT32_MAX) return -1;
+
+  xdl_symoff_header_t hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = XDL_SYMOFF_MAGIC;
+  hdr.version = XDL_SYMOFF_VERSION;
+  hdr.libs_cnt = (uint32_t)used_libs_cnt;
+  hdr.syms_cnt = (uint32_t)syms_cnt;
+  hdr.syms_offset = sizeof(hdr);
+  hdr.libs_offset = hdr.syms_offset + syms_cnt * sizeof(xdl_symoff_sym_t);
+  hdr.strs_offset = hdr.libs_offset + used_libs_cnt * sizeof(xdl_symoff_lib_rec_t);
+  hdr.strs_sz = strs_sz;
+
+  // build the whole file in memory, it is small
+  size_t buf_sz = (size_t)(hdr.strs_offset + strs_sz);
+  uint8_t *buf = (uint8_t *)calloc(1, buf_sz);
+  if (NULL == buf) return -1;
+  memcpy(buf, &hdr, sizeof(hdr));
+  xdl_symoff_sym_t *syms = (xdl_symoff_sym_t *)(buf + hdr.syms_offset);
+  xdl_symoff_lib_rec_t *lib_recs = (xdl_symoff_lib_rec_t *)(buf + hdr.libs_offset);
+  char *strs = (char *)(buf + hdr.strs_offset);
+  size_t syms_idx = 0, strs_offset = 1;  // offset 0 is the empty string
+  for (size_t i = 0; i < libs_cnt; i++) {
+    const xdl_symoff_lib_t *lib = &libs[i];
+    if (0 == lib->build_id_sz || lib->build_id_sz > XDL_SYMOFF_BUILD_ID_MAX) continue;
+
+    lib_recs->build_id_sz = (uint32_t)lib->build_id_sz;
+    memcpy(lib_recs->build_id, lib->build_id, lib->build_id_sz);
+    lib_recs->syms_idx = (uint32_t)syms_idx;
+    lib_recs->syms_cnt = (uint32_t)lib->cnt;
+    for (size_t j = 0; j < lib->cnt; j++) {
+      xdl_symoff_sym_t *sym = &syms[syms_idx + j];
+      size_t name_len = strlen(lib->names[j]);
+      sym->hash = xdl_symoff_hash(lib->names[j]);
+      sym->name_offset = (uint32_t)strs_offset;
+      sym->value = lib->values[j];
+      sym->size = lib->sizes[j];
+      memcpy(strs + strs_offset, lib->names[j], name_len + 1);
+      strs_offset += name_len + 1;
+    }
+    qsort(&syms[syms_idx], lib->cnt, sizeof(xdl_symoff_sym_t), xdl_symoff_sym_cmp);
+    syms_idx += lib->cnt;
+    lib_recs++;
+  }
+
+  // write to a private temporary file, then publish it atomically
+  int r = -1;
+  char tmp_pathname[PATH_MAX + 32];
+  snprintf(tmp_pathname, sizeof(tmp_pathname), "%s.%d.tmp", pathname, getpid());
+  int fd = open(tmp_pathname, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) goto end;
+  fchmod(fd, 0644);  // readable by apps regardless of the umask of the writer
+  if (0 != xdl_symoff_write(fd, buf, buf_sz)) {
+    close(fd);
+    unlink(tmp_pathname);
+    goto end;
+  }
+  if (0 != close(fd) || 0 != rename(tmp_pathname, pathname)) {
+    unlink(tmp_pathname);
+    goto end;
+  }
+  r = 0;
+
+end:
+  free(buf);
+  return r;
+}
+
+static xdl_symoff_table_t *xdl_symoff_load(const char *pathname) {
+  int fd = open(pathname, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return NULL;
+  struct stat st;
+  if (0 != fstat(fd, &st) || (size_t)st.st_size < sizeof(xdl_symoff_header_t)) {
+    close(fd);
+    return NULL;
+  }
+  size_t map_sz = (size_t)st.st_size;
+  void *map = mmap(NULL, map_sz, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (MAP_FAILED == map) return NULL;
+
+  // check header
+  xdl_symoff_header_t *hdr = (xdl_symoff_header_t *)map;
+  if (XDL_SYMOFF_MAGIC != hdr->magic || XDL_SYMOFF_VERSION != hdr->version) goto err;
+
+  // check bounds
+  if (0 != hdr->syms_offset % sizeof(uint64_t) || 0 != hdr->libs_offset % sizeof(uint32_t)) goto err;
+  if (hdr->syms_offset > map_sz || hdr->syms_cnt > (map_sz - hdr->syms_offset) / sizeof(xdl_symoff_sym_t))
+    goto err;
+  if (hdr->libs_offset > map_sz || hdr->libs_cnt > (map_sz - hdr->libs_offset) / sizeof(xdl_symoff_lib_rec_t))
+    goto err;
+  if (0 == hdr->strs_sz || hdr->strs_offset > map_sz || hdr->strs_sz > map_sz - hdr->strs_offset) goto err;
+  const char *strs = (const char *)((uintptr_t)map + hdr->strs_offset);
+  if ('\0' != strs[hdr->strs_sz - 1]) goto err;
+  const xdl_symoff_lib_rec_t *libs = (const xdl_symoff_lib_rec_t *)((uintptr_t)map + hdr->libs_offset);
+  for (uint32_t i = 0; i < hdr->libs_cnt; i++) {
+    if (libs[i].build_id_sz > XDL_SYMOFF_BUILD_ID_MAX) goto err;
+    if (libs[i].syms_idx > hdr->syms_cnt || libs[i].syms_cnt > hdr->syms_cnt - libs[i].syms_idx) goto err;
+  }
+
+  xdl_symoff_table_t *table = (xdl_symoff_table_t *)malloc(sizeof(xdl_symoff_table_t));
+  if (NULL == table) goto err;
+  table->map = map;
+  table->map_sz = map_sz;
+  table->syms = (const xdl_symoff_sym_t *)((uintptr_t)map + hdr->syms_offset);
+  table->libs = libs;
+  table->libs_cnt = hdr->libs_cnt;
+  table->strs = strs;
+  table->strs_sz = (size_t)hdr->strs_sz;
+  return table;
+
+err:
+  munmap(map, map_sz);
+  return NULL;
+}
+
+int xdl_symoff_set_file(const char *pathname) {
+  xdl_symoff_table_t *table = NULL;
+  if (NULL != pathname && NULL == (table = xdl_symoff_load(pathname))) return -1;
+
+  // a replaced table stays mapped, lookups on other threads may still be reading it
+  atomic_store_explicit(&xdl_symoff_table, table, memory_order_release);
+  return 0;
+}
+
+int xdl_symoff_find(const uint8_t *build_id, size_t build_id_sz, const char *name, uint64_t *value,
+                    uint64_t *size) {
+  xdl_symoff_table_t *table = atomic_load_explicit(&xdl_symoff_table, memory_order_acquire);
+  if (NULL == table) return -1;
+
+  for (uint32_t i = 0; i < table->libs_cnt; i++) {
+    const xdl_symoff_lib_rec_t *lib = &table->libs[i];
+    if (build_id_sz != lib->build_id_sz || 0 != memcmp(build_id, lib->build_id, build_id_sz)) continue;
+
+    // lower bound of the hash, then compare names of the same hash
+    const xdl_symoff_sym_t *syms = table->syms + lib->syms_idx;
+    uint32_t hash = xdl_symoff_hash(name);
+    size_t lo = 0, hi = lib->syms_cnt;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (syms[mid].hash < hash)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    for (; lo < lib->syms_cnt && syms[lo].hash == hash; lo++) {
+      if (syms[lo].name_offset >= table->strs_sz) continue;
+      if (0 != strcmp(table->strs + syms[lo].name_offset, name)) continue;
+
+      *value = syms[lo].value;
+      *size = syms[lo].size;
+      return 0;
+    }
+    return -1;
+  }
+  return -1;
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2020-2023 HexHacking Team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#ifndef IO_GITHUB_HEXHACKING_XDL_SYMOFF
+#define IO_GITHUB_HEXHACKING_XDL_SYMOFF
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Symbol offset table: (build-id, symbol name) -> st_value & st_size of .symtab symbols, resolved
+// ahead of time in another process. Names that were looked up but are not in .symtab are recorded
+// too, so that a known miss does not load .symtab either.
+#define XDL_SYMOFF_ABSENT UINT64_MAX  // value of a known miss
+
+typedef struct {
+  const uint8_t *build_id;
+  size_t build_id_sz;
+  const char **names;
+  const uint64_t *values;  // XDL_SYMOFF_ABSENT for names not in .symtab
+  const uint64_t *sizes;
+  size_t cnt;
+} xdl_symoff_lib_t;
+
+int xdl_symoff_save(const char *pathname, const xdl_symoff_lib_t *libs, size_t libs_cnt);
+
+int xdl_symoff_set_file(const char *pathname);
+
+// return 0 when the table covers the symbol (*value may be XDL_SYMOFF_ABSENT), -1 otherwise
+int xdl_symoff_find(const uint8_t *build_id, size_t build_id_sz, const char *name, uint64_t *value,
+                    uint64_t *size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -23,7 +23,6 @@
 
 #include "xdl_util.h"
 
-#include <android/api-level.h>
 #include <ctype.h>
 #include <inttypes.h>
 #include <stdbool.h>
@@ -60,6 +59,7 @@ size_t xdl_util_trim_ending(char *start) {
   return (size_t)(end - start);
 }
 
+#ifdef __ANDROID__
 static int xdl_util_get_api_level_from_build_prop(void) {
   char buf[128];
   int api_level = -1;
@@ -78,14 +78,19 @@ static int xdl_util_get_api_level_from_build_prop(void) {
 end:
   return (api_level > 0) ? api_level : -1;
 }
+#endif
 
 int xdl_util_get_api_level(void) {
   static int xdl_util_api_level = -1;
 
   if (xdl_util_api_level < 0) {
+#ifdef __ANDROID__
     int api_level = android_get_device_api_level();
     if (api_level < 0)
       api_level = xdl_util_get_api_level_from_build_prop();  // compatible with unusual models
+#else
+    int api_level = __ANDROID_API_FUTURE__;  // host: no device, take the current paths
+#endif
     if (api_level < __ANDROID_API_J__) api_level = __ANDROID_API_J__;
 
     __atomic_store_n(&xdl_util_api_level, api_level, __ATOMIC_SEQ_CST);
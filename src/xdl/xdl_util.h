@@ -28,6 +28,34 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#ifdef __ANDROID__
+#include <android/api-level.h>
+#else
+// host builds (tests and benchmarks): what bionic provides and xDL relies on
+#define __ANDROID_API_J__      16
+#define __ANDROID_API_L__      21
+#define __ANDROID_API_L_MR1__  22
+#define __ANDROID_API_M__      23
+#define __ANDROID_API_N__      24
+#define __ANDROID_API_N_MR1__  25
+#define __ANDROID_API_O__      26
+#define __ANDROID_API_O_MR1__  27
+#define __ANDROID_API_P__      28
+#define __ANDROID_API_Q__      29
+#define __ANDROID_API_FUTURE__ 10000
+#define __predict_true(exp)    __builtin_expect((exp) != 0, 1)
+#define __predict_false(exp)   __builtin_expect((exp) != 0, 0)
+#define ELF_ST_BIND(x)         ((x) >> 4)
+#define ELF_ST_TYPE(x)         ((x)&0xf)
+#endif
+
+// d_ptr of a loaded ELF's .dynamic as a vaddr: bionic leaves it as is, glibc relocates it in place
+#ifdef __ANDROID__
+#define XDL_UTIL_DYN_PTR_TO_VADDR(d_ptr, load_bias) (d_ptr)
+#else
+#define XDL_UTIL_DYN_PTR_TO_VADDR(d_ptr, load_bias) ((d_ptr) >= (load_bias) ? (d_ptr) - (load_bias) : (d_ptr))
+#endif
+
 #ifndef __LP64__
 #define XDL_UTIL_LINKER_BASENAME        "linker"
 #define XDL_UTIL_LINKER_PATHNAME        "/system/bin/linker"
@@ -73,15 +73,19 @@ public final class ConfigStore {
         try {
             Config safe = cfg != null ? cfg : new Config("", 0, Config.MODE_LISTEN, "0.0.0.0", 8086, DEFAULT_SCRIPT_PATH);
 
-            JSONObject packageMode = new JSONObject();
+            // Start from the existing config so keys this screen does not edit (e.g. "payloads") survive.
+            JSONObject moduleConfig = readJson(CONFIG_PATH);
+            if (moduleConfig == null) moduleConfig = new JSONObject();
+
+            JSONObject packageObj = moduleConfig.optJSONObject("package");
+            if (packageObj == null) packageObj = new JSONObject();
+            JSONObject packageMode = packageObj.optJSONObject("mode");
+            if (packageMode == null) packageMode = new JSONObject();
             packageMode.put("config", true);
 
-            JSONObject packageObj = new JSONObject();
             packageObj.put("name", safe.packageName);
             packageObj.put("delay", safe.delayMicros);
             packageObj.put("mode", packageMode);
-
-            JSONObject moduleConfig = new JSONObject();
             moduleConfig.put("package", packageObj);
 
             JSONObject interaction = new JSONObject();